@@ -0,0 +1,89 @@
+#ifndef __PrimeEngineBitStream_H__
+#define __PrimeEngineBitStream_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+// Writes values of arbitrary bit width into a byte buffer, most significant bit first.
+// Bit order doesn't depend on platform endianness, so the buffer can go straight into a packet.
+struct BitWriter
+{
+	BitWriter(char *pData, int maxBytes)
+		: m_pData(pData)
+		, m_maxBits(maxBytes * 8)
+		, m_bitPos(0)
+	{}
+
+	void writeBits(PrimitiveTypes::UInt32 v, int numBits)
+	{
+		assert(numBits > 0 && numBits <= 32);
+		assert(m_bitPos + numBits <= m_maxBits);
+
+		for (int i = numBits - 1; i >= 0; --i)
+		{
+			int byte = m_bitPos >> 3;
+			int bit = 7 - (m_bitPos & 7);
+			if (bit == 7)
+				m_pData[byte] = 0; // starting new byte
+
+			if ((v >> i) & 1)
+				m_pData[byte] |= (char)(1 << bit);
+			++m_bitPos;
+		}
+	}
+
+	void writeBool(bool v){writeBits(v ? 1 : 0, 1);}
+
+	int bitsLeft() const {return m_maxBits - m_bitPos;}
+	int bytesWritten() const {return (m_bitPos + 7) >> 3;}
+
+	char *m_pData;
+	int m_maxBits;
+	int m_bitPos;
+};
+
+struct BitReader
+{
+	BitReader(char *pData, int numBytes)
+		: m_pData(pData)
+		, m_maxBits(numBytes * 8)
+		, m_bitPos(0)
+	{}
+
+	PrimitiveTypes::UInt32 readBits(int numBits)
+	{
+		assert(numBits > 0 && numBits <= 32);
+		assert(m_bitPos + numBits <= m_maxBits);
+
+		PrimitiveTypes::UInt32 v = 0;
+		for (int i = 0; i < numBits; ++i)
+		{
+			int byte = m_bitPos >> 3;
+			int bit = 7 - (m_bitPos & 7);
+			v = (v << 1) | ((m_pData[byte] >> bit) & 1);
+			++m_bitPos;
+		}
+		return v;
+	}
+
+	bool readBool(){return readBits(1) != 0;}
+
+	int bytesRead() const {return (m_bitPos + 7) >> 3;}
+	int bitsLeft() const {return m_maxBits - m_bitPos;}
+
+	char *m_pData;
+	int m_maxBits;
+	int m_bitPos;
+};
+
+}; // namespace PE
+#endif
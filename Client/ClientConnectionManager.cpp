@@ -8,7 +8,9 @@
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -19,7 +21,9 @@ extern "C"
 
 #include "PrimeEngine/../../GlobalConfig/GlobalConfig.h"
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
 #include "PrimeEngine/Events/StandardEvents.h"
 
 
@@ -8,7 +8,9 @@
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -19,7 +21,9 @@ extern "C"
 
 #include "PrimeEngine/../../GlobalConfig/GlobalConfig.h"
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
 #include "PrimeEngine/Events/StandardEvents.h"
 
 
@@ -51,7 +55,7 @@ void ClientConnectionManager::addDefaultComponents()
 	ConnectionManager::addDefaultComponents();
 }
 
-// #if 0 //template
+#if !PE_NETWORKING_HEADLESS
 //////////////////////////////////////////////////////////////////////////
 // ConnectionManager Lua Interface
 //////////////////////////////////////////////////////////////////////////
@@ -93,6 +97,6 @@ int ClientConnectionManager::l_clientConnectToUDPServer(lua_State *luaVM)
 
 	return 0; // no return values
 }
-// #endif
+#endif
 }; // namespace Components
 }; // namespace PE
@@ -69,9 +69,11 @@ struct ClientNetworkManager : public NetworkManager
 	// Skin Lua Interface
 	//////////////////////////////////////////////////////////////////////////
 	//
+#if !PE_NETWORKING_HEADLESS
 	static void SetLuaFunctions(PE::Components::LuaEnvironment *pLuaEnv, lua_State *luaVM);
 	//
 	static int l_clientConnectToTCPServer(lua_State *luaVM);
+#endif
 	//
 	//////////////////////////////////////////////////////////////////////////
 
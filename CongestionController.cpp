@@ -0,0 +1,93 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "CongestionController.h"
+
+// Outer-Engine includes
+#include <math.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+CongestionController::CongestionController()
+: m_srtt(0)
+, m_rttVar(0)
+, m_lossRate(0)
+, m_sendRate(1.0f)
+, m_minRate(1.0f)
+, m_maxRate(1.0f)
+, m_lastDecreaseTime(-1.0)
+, m_numLost(0)
+, m_numDelivered(0)
+, m_numDecreases(0)
+{}
+
+void CongestionController::setRateLimits(float minRate, float maxRate)
+{
+	assert(minRate > 0 && minRate <= maxRate);
+	bool wasAtMax = m_sendRate >= m_maxRate;
+
+	m_minRate = minRate;
+	m_maxRate = maxRate;
+
+	// new connection or limit raised while we were not congested: start at the top, back off on loss
+	if (wasAtMax && !m_numDecreases)
+		m_sendRate = maxRate;
+
+	if (m_sendRate > m_maxRate)
+		m_sendRate = m_maxRate;
+	if (m_sendRate < m_minRate)
+		m_sendRate = m_minRate;
+}
+
+void CongestionController::addRttSample(float rtt)
+{
+	if (m_srtt == 0)
+	{
+		m_srtt = rtt;
+		m_rttVar = rtt / 2.0f;
+		return;
+	}
+
+	m_rttVar += (fabsf(m_srtt - rtt) - m_rttVar) / 4.0f;
+	m_srtt += (rtt - m_srtt) / 8.0f;
+}
+
+void CongestionController::onPacketNotification(bool delivered, double sendTime, double now)
+{
+	m_lossRate += ((delivered ? 0.0f : 1.0f) - m_lossRate) * PE_CONGESTION_LOSS_GAIN;
+
+	if (delivered)
+	{
+		++m_numDelivered;
+
+		// rate * rtt packets are delivered per round trip, each adds its share of the increase
+		float rtt = m_srtt ? m_srtt : PE_CONGESTION_INITIAL_RTT;
+		float packetsPerRtt = m_sendRate * rtt;
+		if (packetsPerRtt < 1.0f)
+			packetsPerRtt = 1.0f;
+
+		m_sendRate += PE_CONGESTION_ADDITIVE_INCREASE / packetsPerRtt;
+		if (m_sendRate > m_maxRate)
+			m_sendRate = m_maxRate;
+		return;
+	}
+
+	++m_numLost;
+
+	if (sendTime <= m_lastDecreaseTime)
+		return; // same congestion event
+
+	m_sendRate *= PE_CONGESTION_MULTIPLICATIVE_DECREASE;
+	if (m_sendRate < m_minRate)
+		m_sendRate = m_minRate;
+
+	m_lastDecreaseTime = now;
+	++m_numDecreases;
+}
+
+}; // namespace PE
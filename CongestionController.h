@@ -0,0 +1,71 @@
+#ifndef __PrimeEngineCongestionController_H__
+#define __PrimeEngineCongestionController_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+// weight of newest sample in packet loss estimate
+#define PE_CONGESTION_LOSS_GAIN 0.05f
+
+// packets per second added every round trip without loss
+#define PE_CONGESTION_ADDITIVE_INCREASE 1.0f
+
+// send rate is multiplied by this on loss, at most once per round trip
+#define PE_CONGESTION_MULTIPLICATIVE_DECREASE 0.5f
+
+// rtt assumed until first sample (seconds)
+#define PE_CONGESTION_INITIAL_RTT 0.2f
+
+namespace PE {
+
+// Estimates round trip time and packet loss of one connection from acknowledgments and adjusts
+// send rate with AIMD: rate grows by PE_CONGESTION_ADDITIVE_INCREASE every round trip in which packets
+// are delivered and is cut by PE_CONGESTION_MULTIPLICATIVE_DECREASE on loss. Losses of packets sent before
+// the last cut belong to the same congestion event and don't cut again.
+// Rate stays between minRate and maxRate (the negotiated packet rate). See StreamManager::processAcks().
+struct CongestionController
+{
+	CongestionController();
+
+	void setRateLimits(float minRate, float maxRate);
+
+	/// round trip sample in seconds, same estimator as TCP (RFC 6298)
+	void addRttSample(float rtt);
+
+	/// called for every packet once it is known to be delivered or lost
+	void onPacketNotification(bool delivered, double sendTime, double now);
+
+	float getSendRate(){return m_sendRate;}
+	float getSrtt(){return m_srtt;} // 0 until first sample
+	float getRttVar(){return m_rttVar;}
+	float getRto(){return m_srtt ? m_srtt + 4.0f * m_rttVar : 2.0f * PE_CONGESTION_INITIAL_RTT;} // retransmission timeout
+	float getLossRate(){return m_lossRate;} // 0..1
+	int getNumLost(){return m_numLost;}
+	int getNumDelivered(){return m_numDelivered;}
+	int getNumDecreases(){return m_numDecreases;}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	float m_srtt;
+	float m_rttVar;
+	float m_lossRate;
+	float m_sendRate;
+	float m_minRate;
+	float m_maxRate;
+	double m_lastDecreaseTime; // packets sent before this are part of congestion event we already reacted to
+	int m_numLost;
+	int m_numDelivered;
+	int m_numDecreases;
+};
+
+}; // namespace PE
+#endif
@@ -8,7 +8,9 @@
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "../Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -22,6 +24,7 @@ extern "C"
 
 // Sibling/Children includes
 #include "StreamManager.h"
+#include "NetworkManager.h"
 
 using namespace PE::Events;
 
@@ -37,6 +40,7 @@ ConnectionManager::ConnectionManager(PE::GameContext &context, PE::MemoryArena a
 , m_bytesBuffered(0)
 {
 	m_pNetContext = &netContext;
+	m_lastTickNumber = m_pContext->getNetworkManager()->getTickNumber();
 }
 
 ConnectionManager::~ConnectionManager()
@@ -62,6 +66,9 @@ void ConnectionManager::addDefaultComponents()
 
 void ConnectionManager::disconnect()
 {
+	if (m_state == ConnectionManagerState_Disconnected)
+		return; // socket is already closed
+
 	m_state = ConnectionManagerState_Disconnected;
 	socket_destroy(&m_sock);
 }
@@ -109,17 +116,18 @@ void ConnectionManager::sendPacket(Packet *pPacket, TransmissionRecord *pTransmi
 	
 		return;
 	}
-	
-	// since we are using tcp, we know packets are reliable
-	// in future we will sue UDP with actual ACK packets
-	// for now, just simulate acknowledgments by storing a list of acknowledgments we are supposed to receive
-	AckSim sim;
-	sim.m_packetId = pTransmissionRecord->m_id;
-	sim.m_delivered = true;
-	m_ackSimulation.push_back(sim);
+
+	// delivery of this packet will be known once the other side acknowledges it in its packet header
+	// see StreamManager::processAcks()
 }
 
 void ConnectionManager::receivePackets()
+{
+	readPackets();
+	dispatchPackets();
+}
+
+void ConnectionManager::readPackets()
 {
 	if (m_state != ConnectionManagerState_Connected)
 	{
@@ -174,18 +182,15 @@ void ConnectionManager::receivePackets()
 	
             if (m_bytesBuffered >= packetSize)
             {
-                PE::Packet *pPacket = (PE::Packet *)(pemalloc(m_arena, packetSize));
-
-                memcpy(&pPacket->m_data[0], m_buffer, packetSize);
+                // queued for dispatchPackets(). every packet starts 4 byte aligned
+                int offset = (int)(m_receivedPackets.size());
+                m_receivedPackets.resize(offset + ((packetSize + 3) & ~3));
+                memcpy(&m_receivedPackets[offset], m_buffer, packetSize);
 
 				if (m_bytesBuffered - packetSize > 0) // if we have data trailing current packet
 					memmove(m_buffer, &m_buffer[packetSize], m_bytesBuffered - packetSize);
 
                 m_bytesBuffered -= packetSize;
-
-                m_pNetContext->getStreamManager()->receivePacket(pPacket);
-
-                pefree(m_arena, pPacket);
             }
             else
             {
@@ -193,25 +198,41 @@ void ConnectionManager::receivePackets()
                 else return;
             }
 			//counter++;s
-            // todo: send acknowledgement packet
         }
 		
     }
 }
 
-void ConnectionManager::do_UPDATE(Events::Event *pEvt)
+void ConnectionManager::dispatchPackets()
 {
-	receivePackets();
-	// ack packet simulation
-	for (unsigned int i = 0; i < m_ackSimulation.size(); ++i)
+	int offset = 0;
+	while (offset < (int)(m_receivedPackets.size()))
 	{
-		int packetId = m_ackSimulation[i].m_packetId;
-		bool delivered = m_ackSimulation[i].m_delivered;
+		PE::Packet *pPacket = (PE::Packet *)(&m_receivedPackets[offset]);
+
+		PrimitiveTypes::Int32 packetSize;
+		StreamManager::ReadInt32(&pPacket->m_data[0], packetSize);
+
+		m_pNetContext->getStreamManager()->receivePacket(pPacket);
 
-		// important: notify events have to happen in same order as the packets were sent
-		m_pNetContext->getStreamManager()->processNotification(delivered);
+		offset += (packetSize + 3) & ~3;
 	}
-	m_ackSimulation.clear();
+
+	m_receivedPackets.clear();
+}
+
+void ConnectionManager::do_UPDATE(Events::Event *pEvt)
+{
+	// runs at network tick rate, not frame rate. one receive drains everything that arrived during all ticks of this frame
+	// (ticks are advanced here too, network manager may update after its children)
+	NetworkManager *pNetworkManager = m_pContext->getNetworkManager();
+	pNetworkManager->runTicks();
+	if (pNetworkManager->getTickNumber() == m_lastTickNumber)
+		return;
+	m_lastTickNumber = pNetworkManager->getTickNumber();
+
+	// acknowledgments come in with received packets and trigger delivery notifications
+	receivePackets();
 }
 
 #if 0 // template
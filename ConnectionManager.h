@@ -22,6 +22,7 @@ extern "C"
 // Sibling/Children includes
 #include "PrimeEngine/Networking/NetworkContext.h"
 #include "Packet.h"
+#include "NetworkingConfig.h"
 
 namespace PE {
 namespace Components {
@@ -50,7 +51,14 @@ struct ConnectionManager : public Component
 
 	void sendPacket(Packet *pPacket, TransmissionRecord *pTransmissionRecord);
 	
+	/// readPackets() followed by dispatchPackets()
 	void receivePackets();
+
+	/// reads socket and queues complete packets. touches only this connection, can run on worker thread
+	void readPackets();
+
+	/// hands queued packets to StreamManager. events and moves reach game objects, has to run on game thread
+	void dispatchPackets();
 	bool connected() const {return m_state == ConnectionManagerState_Connected;}
 	void disconnect();
 
@@ -77,13 +85,6 @@ struct ConnectionManager : public Component
 	//////////////////////////////////////////////////////////////////////////
 	// Member variables 
 	//////////////////////////////////////////////////////////////////////////
-	struct AckSim
-	{
-		bool m_delivered;
-		int m_packetId;
-	};
-	std::vector<AckSim> m_ackSimulation;
-
 	PE::NetworkContext *m_pNetContext;
 
 	/*luasocket::*/t_socket m_sock; // tcp connection socket
@@ -94,6 +95,10 @@ struct ConnectionManager : public Component
 	int m_bytesBuffered;
 	char m_buffer[PE_SOCKET_RECEIVE_BUFFER_SIZE];
 
+	std::vector<char> m_receivedPackets; // complete packets waiting for dispatchPackets()
+
+	PrimitiveTypes::UInt32 m_lastTickNumber; // network tick packets were last received on (do_UPDATE)
+
 };
 }; // namespace Components
 }; // namespace PE
@@ -0,0 +1,89 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ConnectionStateTable.h"
+
+// Outer-Engine includes
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+#include "Packet.h"
+
+namespace PE {
+
+ConnectionStateTable::ConnectionStateTable(int numSlots)
+{
+	resize(numSlots);
+}
+
+void ConnectionStateTable::resize(int numSlots)
+{
+	m_nextIdToTransmit.resize(numSlots, 0);
+	m_nextIdToBeAcknowledged.resize(numSlots, 1);
+	m_lastReceivedPacketId.resize(numSlots, 0);
+	m_receivedAckBits.resize(numSlots, 0);
+	m_ackPending.resize(numSlots, 0);
+	m_numPacketsInFlight.resize(numSlots, 0);
+	m_packetTokens.resize(numSlots, 0);
+	m_lastRefillTime.resize(numSlots, -1.0);
+	m_sendRate.resize(numSlots, 0);
+	m_lastSendTime.resize(numSlots, 0);
+	m_lastReceiveTime.resize(numSlots, 0);
+}
+
+void ConnectionStateTable::resetSlot(int slot, double now)
+{
+	assert(slot >= 0 && slot < size());
+
+	m_nextIdToTransmit[slot] = 0;
+	m_nextIdToBeAcknowledged[slot] = 1;
+	m_lastReceivedPacketId[slot] = 0;
+	m_receivedAckBits[slot] = 0;
+	m_ackPending[slot] = 0;
+	m_numPacketsInFlight[slot] = 0;
+	m_packetTokens[slot] = PE_PACKET_BURST;
+	m_lastRefillTime[slot] = -1.0;
+	m_sendRate[slot] = PE_PACKET_DEFAULT_RATE;
+	m_lastSendTime[slot] = now;
+	m_lastReceiveTime[slot] = now;
+}
+
+void ConnectionStateTable::copySlot(int slot, ConnectionStateTable &from, int fromSlot)
+{
+	assert(slot >= 0 && slot < size());
+
+	m_nextIdToTransmit[slot] = from.m_nextIdToTransmit[fromSlot];
+	m_nextIdToBeAcknowledged[slot] = from.m_nextIdToBeAcknowledged[fromSlot];
+	m_lastReceivedPacketId[slot] = from.m_lastReceivedPacketId[fromSlot];
+	m_receivedAckBits[slot] = from.m_receivedAckBits[fromSlot];
+	m_ackPending[slot] = from.m_ackPending[fromSlot];
+	m_numPacketsInFlight[slot] = from.m_numPacketsInFlight[fromSlot];
+	m_packetTokens[slot] = from.m_packetTokens[fromSlot];
+	m_lastRefillTime[slot] = from.m_lastRefillTime[fromSlot];
+	m_sendRate[slot] = from.m_sendRate[fromSlot];
+	m_lastSendTime[slot] = from.m_lastSendTime[fromSlot];
+	m_lastReceiveTime[slot] = from.m_lastReceiveTime[fromSlot];
+}
+
+void ConnectionStateTable::refillTokens(int slot, double now)
+{
+	if (m_lastRefillTime[slot] < 0)
+		m_lastRefillTime[slot] = now;
+
+	float dt = (float)(now - m_lastRefillTime[slot]);
+	m_lastRefillTime[slot] = now;
+
+	m_packetTokens[slot] += dt * m_sendRate[slot];
+	if (m_packetTokens[slot] > PE_PACKET_BURST)
+		m_packetTokens[slot] = PE_PACKET_BURST;
+}
+
+void ConnectionStateTable::refillTokens(const int *pSlots, int numSlots, double now)
+{
+	for (int i = 0; i < numSlots; ++i)
+		refillTokens(pSlots[i], now);
+}
+
+}; // namespace PE
@@ -0,0 +1,70 @@
+#ifndef __PrimeEngineConnectionStateTable_H__
+#define __PrimeEngineConnectionStateTable_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <vector>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+// Per tick state of connections (sequence numbers, ack state, send budget, liveness) stored as parallel arrays.
+// Each StreamManager owns one slot; on server all stream managers share one table indexed by client id,
+// so that tick loops (token refill, send readiness, timeouts) walk flat arrays instead of visiting every connection's
+// managers. Everything else about a connection stays in its managers.
+// Table does not grow while connections are serviced: server sizes it for max number of connections up front.
+struct ConnectionStateTable
+{
+	ConnectionStateTable(int numSlots = 1);
+
+	void resize(int numSlots);
+	int size(){return (int)(m_lastReceiveTime.size());}
+
+	/// sets slot to state of new connection
+	void resetSlot(int slot, double now);
+
+	/// copies slot of other table (connection state moves from stream manager's own table to shared one)
+	void copySlot(int slot, ConnectionStateTable &from, int fromSlot);
+
+	/// adds tokens earned since last refill at slot's send rate
+	void refillTokens(int slot, double now);
+
+	/// refills all listed slots in one pass
+	void refillTokens(const int *pSlots, int numSlots, double now);
+
+	/// token bucket allows a packet to go out
+	bool canSend(int slot){return m_packetTokens[slot] >= 1.0f;}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	// sequence and ack state
+	std::vector<int> m_nextIdToTransmit;
+	std::vector<int> m_nextIdToBeAcknowledged;
+	std::vector<int> m_lastReceivedPacketId; // 0 = nothing received yet
+	std::vector<PrimitiveTypes::UInt32> m_receivedAckBits; // bit i set = packet (m_lastReceivedPacketId - 1 - i) was received
+	std::vector<char> m_ackPending; // received packet that needs acknowledgment
+
+	// queue lengths
+	std::vector<int> m_numPacketsInFlight; // sent, not yet acknowledged or known lost
+
+	// token bucket. rate is a copy of stream manager's current value
+	// (bytes are bounded by packet size, every packet is at most stream manager's datagram size)
+	std::vector<float> m_packetTokens;
+	std::vector<double> m_lastRefillTime; // < 0 = never refilled
+	std::vector<float> m_sendRate; // packets per second
+
+	// liveness
+	std::vector<double> m_lastSendTime;
+	std::vector<double> m_lastReceiveTime;
+};
+
+}; // namespace PE
+#endif
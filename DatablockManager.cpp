@@ -0,0 +1,531 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "DatablockManager.h"
+
+// Outer-Engine includes
+#include <string.h>
+
+// Inter-Engine includes
+
+#if !PE_NETWORKING_HEADLESS
+#include "../Lua/LuaEnvironment.h"
+#endif
+
+// additional lua includes needed
+extern "C"
+{
+#include "../../luasocket_dist/src/socket.h"
+#include "../../luasocket_dist/src/inet.h"
+};
+
+#include "../../../GlobalConfig/GlobalConfig.h"
+
+#include "PrimeEngine/Events/StandardEvents.h"
+
+#if !PE_NETWORKING_HEADLESS
+#include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
+
+#include "StreamManager.h"
+// Sibling/Children includes
+using namespace PE::Events;
+
+namespace PE {
+namespace Components {
+
+PE_IMPLEMENT_CLASS1(DatablockManager, Component);
+
+DatablockManager::DatablockManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself)
+: Component(context, arena, hMyself)
+, m_numFragmentsInFlight(0)
+, m_pHandler(NULL)
+{
+	m_pNetContext = &netContext;
+}
+
+DatablockManager::~DatablockManager()
+{
+
+}
+
+void DatablockManager::initialize()
+{
+
+}
+
+void DatablockManager::addDefaultComponents()
+{
+	Component::addDefaultComponents();
+}
+
+DatablockHash DatablockManager::HashData(const char *pData, int size)
+{
+	DatablockHash hash = 14695981039346656037ULL;
+	for (int i = 0; i < size; ++i)
+	{
+		hash ^= (unsigned char)(pData[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+int DatablockManager::findOutgoing(PrimitiveTypes::Int32 datablockId)
+{
+	for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+	{
+		if (m_outgoing[i].m_id == datablockId)
+			return i;
+	}
+	return -1;
+}
+
+int DatablockManager::findIncoming(PrimitiveTypes::Int32 datablockId)
+{
+	for (unsigned int i = 0; i < m_incoming.size(); ++i)
+	{
+		if (m_incoming[i].m_id == datablockId)
+			return i;
+	}
+	return -1;
+}
+
+void DatablockManager::queueDatablock(PrimitiveTypes::Int32 datablockId, const char *pData, int size)
+{
+	assert(findOutgoing(datablockId) < 0);
+	assert(size >= 0 && size <= PE_DATABLOCK_MAX_SIZE);
+
+	m_outgoing.push_back(OutgoingDatablock());
+	OutgoingDatablock &block = m_outgoing.back();
+	block.m_id = datablockId;
+	block.m_hash = HashData(pData, size);
+	block.m_pData = pData;
+	block.m_size = size;
+	block.m_offerPending = true;
+	block.m_replied = false;
+	block.m_wanted = false;
+	block.m_fragmentStates.resize(NumFragments(size), (char)(FragmentState_NotSent));
+	block.m_numFragmentsDelivered = 0;
+	block.m_firstNotSent = 0;
+}
+
+void DatablockManager::getProgress(int &out_bytesDone, int &out_bytesTotal)
+{
+	out_bytesDone = 0;
+	out_bytesTotal = 0;
+
+	for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+	{
+		OutgoingDatablock &block = m_outgoing[i];
+		if (block.m_replied && !block.m_wanted)
+			continue; // other side has it
+
+		out_bytesTotal += block.m_size;
+		int done = block.m_numFragmentsDelivered * PE_DATABLOCK_FRAGMENT_SIZE;
+		out_bytesDone += done < block.m_size ? done : block.m_size;
+	}
+
+	for (unsigned int i = 0; i < m_incoming.size(); ++i)
+	{
+		IncomingDatablock &block = m_incoming[i];
+		if (!block.m_wanted)
+			continue;
+
+		out_bytesTotal += block.m_size;
+		int done = block.m_complete ? block.m_size : block.m_numFragmentsReceived * PE_DATABLOCK_FRAGMENT_SIZE;
+		out_bytesDone += done < block.m_size ? done : block.m_size;
+	}
+}
+
+bool DatablockManager::isComplete()
+{
+	for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+	{
+		OutgoingDatablock &block = m_outgoing[i];
+		if (!block.m_replied || (block.m_wanted && block.m_numFragmentsDelivered < (int)(block.m_fragmentStates.size())))
+			return false;
+	}
+
+	for (unsigned int i = 0; i < m_incoming.size(); ++i)
+	{
+		if (!m_incoming[i].m_complete)
+			return false;
+	}
+
+	return true;
+}
+
+int DatablockManager::nextFragmentToSend(OutgoingDatablock &block)
+{
+	if (!block.m_replied || !block.m_wanted)
+		return -1;
+
+	for (int i = block.m_firstNotSent; i < (int)(block.m_fragmentStates.size()); ++i)
+	{
+		if (block.m_fragmentStates[i] == FragmentState_NotSent)
+		{
+			block.m_firstNotSent = i;
+			return i;
+		}
+	}
+
+	block.m_firstNotSent = (int)(block.m_fragmentStates.size());
+	return -1;
+}
+
+int DatablockManager::haveDatablocksToSend()
+{
+	int num = 0;
+
+	for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+	{
+		if (m_outgoing[i].m_offerPending)
+			num++;
+	}
+
+	for (unsigned int i = 0; i < m_incoming.size(); ++i)
+	{
+		if (m_incoming[i].m_replyPending)
+			num++;
+	}
+
+	if (m_numFragmentsInFlight < PE_DATABLOCK_WINDOW)
+	{
+		for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+		{
+			if (nextFragmentToSend(m_outgoing[i]) >= 0)
+			{
+				num++;
+				break;
+			}
+		}
+	}
+
+	return num;
+}
+
+int DatablockManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore)
+{
+	out_usefulDataSent = false;
+	out_wantToSendMore = false;
+
+	int size = 0;
+
+	// offers
+	int numOffersOffset = size;
+	int numOffers = 0;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]);
+
+	// leave space for reply and fragment counts
+	int sizeAllocated = packetSizeAllocated - 2 * sizeof(PrimitiveTypes::Int32);
+
+	for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+	{
+		OutgoingDatablock &block = m_outgoing[i];
+		if (!block.m_offerPending)
+			continue;
+
+		if (sizeAllocated - size < 4 * (int)(sizeof(PrimitiveTypes::Int32)))
+			break;
+
+		size += StreamManager::WriteInt32(block.m_id, &pDataStream[size]);
+		size += StreamManager::WriteInt32(block.m_size, &pDataStream[size]);
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(block.m_hash >> 32), &pDataStream[size]);
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(block.m_hash & 0xffffffff), &pDataStream[size]);
+
+		DatablockTransmissionData sent;
+		sent.m_type = DatablockTransmissionData::Type_Offer;
+		sent.m_datablockId = block.m_id;
+		sent.m_fragment = 0;
+		pRecord->m_sentDatablocks.push_back(sent);
+
+		block.m_offerPending = false;
+		numOffers++;
+	}
+	StreamManager::WriteInt32(numOffers, &pDataStream[numOffersOffset]);
+
+	// replies
+	int numRepliesOffset = size;
+	int numReplies = 0;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]);
+	sizeAllocated = packetSizeAllocated - sizeof(PrimitiveTypes::Int32);
+
+	for (unsigned int i = 0; i < m_incoming.size(); ++i)
+	{
+		IncomingDatablock &block = m_incoming[i];
+		if (!block.m_replyPending)
+			continue;
+
+		if (sizeAllocated - size < 2 * (int)(sizeof(PrimitiveTypes::Int32)))
+			break;
+
+		size += StreamManager::WriteInt32(block.m_id, &pDataStream[size]);
+		size += StreamManager::WriteInt32(block.m_wanted ? 1 : 0, &pDataStream[size]);
+
+		DatablockTransmissionData sent;
+		sent.m_type = DatablockTransmissionData::Type_Reply;
+		sent.m_datablockId = block.m_id;
+		sent.m_fragment = 0;
+		pRecord->m_sentDatablocks.push_back(sent);
+
+		block.m_replyPending = false;
+		numReplies++;
+	}
+	StreamManager::WriteInt32(numReplies, &pDataStream[numRepliesOffset]);
+
+	// fragments, datablocks in the order they were queued
+	int numFragmentsOffset = size;
+	int numFragments = 0;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]);
+
+	int fragmentHeaderSize = 2 * sizeof(PrimitiveTypes::Int32) + sizeof(PrimitiveTypes::Int16);
+	bool outOfSpace = false;
+
+	for (unsigned int i = 0; i < m_outgoing.size() && !outOfSpace; ++i)
+	{
+		OutgoingDatablock &block = m_outgoing[i];
+
+		while (m_numFragmentsInFlight < PE_DATABLOCK_WINDOW)
+		{
+			int fragment = nextFragmentToSend(block);
+			if (fragment < 0)
+				break;
+
+			int offset = fragment * PE_DATABLOCK_FRAGMENT_SIZE;
+			int fragmentSize = block.m_size - offset;
+			if (fragmentSize > PE_DATABLOCK_FRAGMENT_SIZE)
+				fragmentSize = PE_DATABLOCK_FRAGMENT_SIZE;
+
+			if (packetSizeAllocated - size < fragmentHeaderSize + fragmentSize)
+			{
+				outOfSpace = true;
+				break;
+			}
+
+			size += StreamManager::WriteInt32(block.m_id, &pDataStream[size]);
+			size += StreamManager::WriteInt32(fragment, &pDataStream[size]);
+			size += StreamManager::WriteInt16((PrimitiveTypes::Int16)(fragmentSize), &pDataStream[size]);
+			memcpy(&pDataStream[size], &block.m_pData[offset], fragmentSize);
+			size += fragmentSize;
+
+			DatablockTransmissionData sent;
+			sent.m_type = DatablockTransmissionData::Type_Fragment;
+			sent.m_datablockId = block.m_id;
+			sent.m_fragment = fragment;
+			pRecord->m_sentDatablocks.push_back(sent);
+
+			block.m_fragmentStates[fragment] = FragmentState_InFlight;
+			m_numFragmentsInFlight++;
+			numFragments++;
+		}
+	}
+	StreamManager::WriteInt32(numFragments, &pDataStream[numFragmentsOffset]);
+
+	// more packets this tick only if window still has room for fragments that didn't fit
+	out_wantToSendMore = outOfSpace && m_numFragmentsInFlight < PE_DATABLOCK_WINDOW;
+	for (unsigned int i = 0; i < m_outgoing.size(); ++i)
+	{
+		if (m_outgoing[i].m_offerPending)
+			out_wantToSendMore = true;
+	}
+	for (unsigned int i = 0; i < m_incoming.size(); ++i)
+	{
+		if (m_incoming[i].m_replyPending)
+			out_wantToSendMore = true;
+	}
+
+	out_usefulDataSent = numOffers > 0 || numReplies > 0 || numFragments > 0;
+
+	return size;
+}
+
+void DatablockManager::processNotification(TransmissionRecord *pTransmittionRecord, bool delivered)
+{
+	for (unsigned int i = 0; i < pTransmittionRecord->m_sentDatablocks.size(); ++i)
+	{
+		DatablockTransmissionData &sent = pTransmittionRecord->m_sentDatablocks[i];
+
+		if (sent.m_type == DatablockTransmissionData::Type_Offer)
+		{
+			int iBlock = findOutgoing(sent.m_datablockId);
+			if (!delivered && iBlock >= 0 && !m_outgoing[iBlock].m_replied)
+				m_outgoing[iBlock].m_offerPending = true;
+		}
+		else if (sent.m_type == DatablockTransmissionData::Type_Reply)
+		{
+			int iBlock = findIncoming(sent.m_datablockId);
+			if (!delivered && iBlock >= 0)
+				m_incoming[iBlock].m_replyPending = true;
+		}
+		else
+		{
+			m_numFragmentsInFlight--;
+
+			int iBlock = findOutgoing(sent.m_datablockId);
+			if (iBlock < 0)
+				continue;
+
+			OutgoingDatablock &block = m_outgoing[iBlock];
+			if (delivered)
+			{
+				block.m_fragmentStates[sent.m_fragment] = FragmentState_Delivered;
+				block.m_numFragmentsDelivered++;
+			}
+			else
+			{
+				block.m_fragmentStates[sent.m_fragment] = FragmentState_NotSent;
+				if (sent.m_fragment < block.m_firstNotSent)
+					block.m_firstNotSent = sent.m_fragment;
+			}
+		}
+	}
+}
+
+void DatablockManager::completeIncoming(IncomingDatablock &block)
+{
+	block.m_complete = true;
+
+	if (HashData(block.m_size ? &block.m_data[0] : NULL, block.m_size) != block.m_hash)
+	{
+		PEINFO("PE: Warning: Datablock %d doesn't match its hash, dropping it\n", block.m_id);
+	}
+	else if (m_pHandler)
+	{
+		m_pHandler->datablock_received(block.m_id, block.m_size ? &block.m_data[0] : NULL, block.m_size);
+	}
+
+	// handler made its own copy
+	std::vector<char>().swap(block.m_data);
+	std::vector<char>().swap(block.m_fragmentReceived);
+}
+
+int DatablockManager::receiveNextPacket(char *pDataStream)
+{
+	int read = 0;
+
+	PrimitiveTypes::Int32 numOffers;
+	read += StreamManager::ReadInt32(&pDataStream[read], numOffers);
+	for (int i = 0; i < numOffers; ++i)
+	{
+		PrimitiveTypes::Int32 datablockId, size, hashHi, hashLo;
+		read += StreamManager::ReadInt32(&pDataStream[read], datablockId);
+		read += StreamManager::ReadInt32(&pDataStream[read], size);
+		read += StreamManager::ReadInt32(&pDataStream[read], hashHi);
+		read += StreamManager::ReadInt32(&pDataStream[read], hashLo);
+
+		int iBlock = findIncoming(datablockId);
+		if (iBlock >= 0)
+		{
+			// our reply didn't make it yet
+			m_incoming[iBlock].m_replyPending = true;
+			continue;
+		}
+
+		m_incoming.push_back(IncomingDatablock());
+		IncomingDatablock &block = m_incoming.back();
+		block.m_id = datablockId;
+		block.m_hash = ((DatablockHash)((PrimitiveTypes::UInt32)(hashHi)) << 32) | (PrimitiveTypes::UInt32)(hashLo);
+		block.m_size = size;
+		block.m_replyPending = true;
+		block.m_wanted = !(m_pHandler && m_pHandler->datablock_haveCached(datablockId, block.m_hash));
+		block.m_complete = false;
+
+		if (size < 0 || size > PE_DATABLOCK_MAX_SIZE)
+		{
+			// refuse, reply tells sender not to send it
+			PEINFO("PE: Warning: Datablock %d offered with invalid size %d, refusing it\n", datablockId, size);
+			block.m_size = 0;
+			block.m_wanted = false;
+		}
+		block.m_numFragmentsReceived = 0;
+
+		if (!block.m_wanted)
+		{
+			block.m_complete = true;
+		}
+		else
+		{
+			block.m_data.resize(size);
+			block.m_fragmentReceived.resize(NumFragments(size), 0);
+			if (size == 0)
+				completeIncoming(block);
+		}
+	}
+
+	PrimitiveTypes::Int32 numReplies;
+	read += StreamManager::ReadInt32(&pDataStream[read], numReplies);
+	for (int i = 0; i < numReplies; ++i)
+	{
+		PrimitiveTypes::Int32 datablockId, wanted;
+		read += StreamManager::ReadInt32(&pDataStream[read], datablockId);
+		read += StreamManager::ReadInt32(&pDataStream[read], wanted);
+
+		int iBlock = findOutgoing(datablockId);
+		if (iBlock < 0 || m_outgoing[iBlock].m_replied)
+			continue;
+
+		OutgoingDatablock &block = m_outgoing[iBlock];
+		block.m_replied = true;
+		block.m_wanted = wanted != 0;
+		block.m_offerPending = false;
+	}
+
+	PrimitiveTypes::Int32 numFragments;
+	read += StreamManager::ReadInt32(&pDataStream[read], numFragments);
+	for (int i = 0; i < numFragments; ++i)
+	{
+		PrimitiveTypes::Int32 datablockId, fragment;
+		PrimitiveTypes::Int16 fragmentSize;
+		read += StreamManager::ReadInt32(&pDataStream[read], datablockId);
+		read += StreamManager::ReadInt32(&pDataStream[read], fragment);
+		read += StreamManager::ReadInt16(&pDataStream[read], fragmentSize);
+
+		int iBlock = findIncoming(datablockId);
+		if (iBlock >= 0)
+		{
+			IncomingDatablock &block = m_incoming[iBlock];
+			// fragment number and size come from the other side, data must land inside the block
+			bool valid = fragment >= 0 && fragment < NumFragments(block.m_size)
+				&& fragmentSize >= 0 && fragmentSize <= PE_DATABLOCK_FRAGMENT_SIZE
+				&& fragment * PE_DATABLOCK_FRAGMENT_SIZE + fragmentSize <= block.m_size;
+
+			if (!valid)
+			{
+				PEINFO("PE: Warning: Datablock %d invalid fragment %d size %d, ignoring it\n", datablockId, fragment, (int)(fragmentSize));
+			}
+			else if (!block.m_complete && block.m_wanted && !block.m_fragmentReceived[fragment])
+			{
+				int offset = fragment * PE_DATABLOCK_FRAGMENT_SIZE;
+				memcpy(&block.m_data[offset], &pDataStream[read], fragmentSize);
+				block.m_fragmentReceived[fragment] = 1;
+				block.m_numFragmentsReceived++;
+
+				if (block.m_numFragmentsReceived == (int)(block.m_fragmentReceived.size()))
+					completeIncoming(block);
+			}
+			// else duplicate of a fragment whose notification was lost
+		}
+
+		if (fragmentSize > 0)
+			read += fragmentSize;
+	}
+
+	return read;
+}
+
+void DatablockManager::debugRender(int &threadOwnershipMask, float xoffset/* = 0*/, float yoffset/* = 0*/)
+{
+#if !PE_NETWORKING_HEADLESS
+	int done, total;
+	getProgress(done, total);
+
+	sprintf(PEString::s_buf, "Datablock Manager: %d/%d bytes, %d fragments in flight", done, total, m_numFragmentsInFlight);
+	DebugRenderer::Instance()->createTextMesh(
+		PEString::s_buf, true, false, false, false, 0,
+		Vector3(xoffset, yoffset, 0), 1.0f, threadOwnershipMask);
+#endif
+}
+
+}; // namespace Components
+}; // namespace PE
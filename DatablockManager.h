@@ -0,0 +1,133 @@
+#ifndef __PrimeEngineDatablockManager_H__
+#define __PrimeEngineDatablockManager_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <vector>
+
+// Inter-Engine includes
+
+#include "../Events/Component.h"
+
+extern "C"
+{
+#include "../../luasocket_dist/src/socket.h"
+};
+
+#include "PrimeEngine/Networking/NetworkContext.h"
+#include "PrimeEngine/Utils/Networkable.h"
+
+// Sibling/Children includes
+#include "Packet.h"
+#include "DatablockTransmissionData.h"
+#include "NetworkingConfig.h"
+
+namespace PE {
+namespace Components {
+
+// Streams large static data blobs (datablocks) over one connection, bypassing event size and queue limits.
+// Sender offers each datablock with its size and content hash; receiver replies whether it wants it or
+// has it cached. Wanted datablocks are split into PE_DATABLOCK_FRAGMENT_SIZE fragments and sent in order
+// with at most PE_DATABLOCK_WINDOW fragments in flight. Delivery is learned from packet notifications,
+// lost offers, replies and fragments are sent again.
+struct DatablockManager : public Component
+{
+	PE_DECLARE_CLASS(DatablockManager);
+
+	// Constructor -------------------------------------------------------------
+	DatablockManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself);
+
+	virtual ~DatablockManager();
+
+	// Methods -----------------------------------------------------------------
+	virtual void initialize();
+
+	/// called by sender to transfer datablock. data is not copied and has to stay valid until transfer is done
+	void queueDatablock(PrimitiveTypes::Int32 datablockId, const char *pData, int size);
+
+	/// called by gameplay code on receiving side
+	void setDatablockHandler(NetDatablockHandler *pHandler){m_pHandler = pHandler;}
+
+	/// progress of all transfers in both directions, bytes done / bytes total
+	void getProgress(int &out_bytesDone, int &out_bytesTotal);
+
+	/// true when everything offered to us arrived (or was cached) and everything we queued was delivered (or skipped)
+	bool isComplete();
+
+	/// called by stream manager to see whether there are datablock messages to send
+	int haveDatablocksToSend();
+
+	/// called by StreamManager to put offers, replies and fragments in packet
+	int fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore);
+
+	/// called by StreamManager to process transmission record deliver notification
+	void processNotification(TransmissionRecord *pTransmittionRecord, bool delivered);
+
+	int receiveNextPacket(char *pDataStream);
+
+	void debugRender(int &threadOwnershipMask, float xoffset = 0, float yoffset = 0);
+
+	static DatablockHash HashData(const char *pData, int size);
+
+	// Component ------------------------------------------------------------
+	virtual void addDefaultComponents();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	enum EFragmentState
+	{
+		FragmentState_NotSent = 0,
+		FragmentState_InFlight,
+		FragmentState_Delivered,
+	};
+
+	struct OutgoingDatablock
+	{
+		PrimitiveTypes::Int32 m_id;
+		DatablockHash m_hash;
+		const char *m_pData;
+		int m_size;
+		bool m_offerPending; // offer has to be (re)sent
+		bool m_replied;
+		bool m_wanted;
+		std::vector<char> m_fragmentStates; // EFragmentState
+		int m_numFragmentsDelivered;
+		int m_firstNotSent; // fragments before this are not in NotSent state, except the lost ones
+	};
+
+	struct IncomingDatablock
+	{
+		PrimitiveTypes::Int32 m_id;
+		DatablockHash m_hash;
+		int m_size;
+		bool m_replyPending; // reply has to be (re)sent
+		bool m_wanted;
+		bool m_complete;
+		std::vector<char> m_data;
+		std::vector<char> m_fragmentReceived;
+		int m_numFragmentsReceived;
+	};
+
+	static int NumFragments(int size){return size ? (size + PE_DATABLOCK_FRAGMENT_SIZE - 1) / PE_DATABLOCK_FRAGMENT_SIZE : 0;}
+
+	int findOutgoing(PrimitiveTypes::Int32 datablockId);
+	int findIncoming(PrimitiveTypes::Int32 datablockId);
+	int nextFragmentToSend(OutgoingDatablock &block);
+	void completeIncoming(IncomingDatablock &block);
+
+	std::vector<OutgoingDatablock> m_outgoing;
+	std::vector<IncomingDatablock> m_incoming;
+	int m_numFragmentsInFlight;
+
+	NetDatablockHandler *m_pHandler;
+
+	PE::NetworkContext *m_pNetContext;
+};
+}; // namespace Components
+}; // namespace PE
+#endif
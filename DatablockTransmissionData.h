@@ -0,0 +1,54 @@
+#ifndef __PrimeEngineDatablockTransmissionData_H__
+#define __PrimeEngineDatablockTransmissionData_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+// max size of datablock data carried by one fragment. small enough to share a datagram with regular traffic
+#define PE_DATABLOCK_FRAGMENT_SIZE 512
+
+// max size of one datablock. bigger offers are refused (size comes from the other side, it can't decide how much we allocate)
+#define PE_DATABLOCK_MAX_SIZE (16 * 1024 * 1024)
+
+// max number of fragments sent but not yet acknowledged or known lost
+#define PE_DATABLOCK_WINDOW 16
+
+// 64 bit FNV-1a of datablock content
+typedef unsigned long long DatablockHash;
+
+// implemented by gameplay code on client to receive static data (configuration, level description, etc.)
+struct NetDatablockHandler
+{
+	// return true if datablock with this content is cached locally, it will not be transferred
+	virtual bool datablock_haveCached(PrimitiveTypes::Int32 datablockId, DatablockHash hash) = 0;
+
+	// whole datablock arrived (and matches its hash). data is valid only during the call
+	virtual void datablock_received(PrimitiveTypes::Int32 datablockId, const char *pData, int size) = 0;
+};
+
+// stored in TransmissionRecord to know which datablock messages were sent in a packet
+struct DatablockTransmissionData
+{
+	enum EType
+	{
+		Type_Offer = 0, // sender announces datablock
+		Type_Reply, // receiver wants it or has it cached
+		Type_Fragment,
+	};
+
+	EType m_type;
+	PrimitiveTypes::Int32 m_datablockId;
+	int m_fragment;
+};
+
+}; // namespace PE
+#endif
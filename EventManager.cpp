@@ -5,10 +5,13 @@
 #include "EventManager.h"
 
 // Outer-Engine includes
+#include <algorithm>
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "../Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -22,7 +25,9 @@ extern "C"
 #include "PrimeEngine/Events/StandardEvents.h"
 #include "PrimeEngine/Networking/NetworkManager.h"
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
 
 #include "StreamManager.h"
 // Sibling/Children includes
@@ -37,13 +42,16 @@ EventManager::EventManager(PE::GameContext &context, PE::MemoryArena arena, PE::
 : Component(context, arena, hMyself)
 , m_transmitterNextEvtOrderId(1) // start at 1 since id = 0 is not ordered
 , m_transmitterNumEventsNotAcked(0)
+, m_transmitterFirstNotAckedOrderId(1)
 
 // receiver
 , m_receiverFirstEvtOrderId(1) // start at 1 since id = 0 is not ordered
+, m_groupUnguaranteedEvents(false)
 {
 	m_pNetContext = &netContext;
 
 	memset(&m_receivedEvents[0], 0, sizeof(m_receivedEvents));
+	memset(&m_transmitterAcked[0], 0, sizeof(m_transmitterAcked));
 }
 
 EventManager::~EventManager()
@@ -63,31 +71,31 @@ void EventManager::addDefaultComponents()
 
 void EventManager::scheduleEvent(PE::Networkable *pNetworkableEvent, PE::Networkable *pNetworkableTarget, bool guaranteed)
 {
-	if (haveEventsToSend() >= PE_MAX_EVENT_JAM)
+	EventTransmissionData packed;
+
 	{
-		assert(!"Sending too many events have to drop, need throttling mechanism here");
-		return;
-	}
+		// net strings of the event are interned in this connection's table
+		StreamManager::ActiveStringTableScope stringTableScope(&m_stringTable);
+		m_stringTable.m_pPackingEvent = &packed;
 
-	m_eventsToSend.push_back(EventTransmissionData());
-	EventTransmissionData &back = m_eventsToSend.back();
-	int dataSize = 0;
+		PackEvent(pNetworkableEvent, pNetworkableTarget, packed);
 
-	back.m_isGuaranteed = guaranteed;
-	if (!guaranteed)
-		back.m_orderId = 0; // zero means not guaranteed
-	else
-		back.m_orderId = m_transmitterNextEvtOrderId++;
+		m_stringTable.m_pPackingEvent = NULL;
+	}
 
-	// debug info to show event id sceduled
-	//PEINFO("Scheduling event order id: %d\n", m_transmitterNextEvtOrderId);
+	schedulePackedEvent(packed, guaranteed);
+}
 
+void EventManager::PackEvent(PE::Networkable *pNetworkableEvent, PE::Networkable *pNetworkableTarget, EventTransmissionData &out_packed)
+{
+	int dataSize = 0;
+	out_packed.m_numStringDefinitions = 0;
 
-	//write ordering id (0 = not guaranteed)
-	dataSize += StreamManager::WriteInt32(back.m_orderId, &back.m_payload[dataSize]);
+	//write ordering id (0 = not guaranteed). real value is written when event is scheduled
+	dataSize += StreamManager::WriteInt32(0, &out_packed.m_payload[dataSize]);
 	
 	//target
-	dataSize += StreamManager::WriteNetworkId(pNetworkableTarget->m_networkId, &back.m_payload[dataSize]);
+	dataSize += StreamManager::WriteNetworkId(pNetworkableTarget->m_networkId, &out_packed.m_payload[dataSize]);
 
 	PrimitiveTypes::Int32 classId = pNetworkableEvent->net_getClassMetaInfo()->m_classId;
 
@@ -96,17 +104,40 @@ void EventManager::scheduleEvent(PE::Networkable *pNetworkableEvent, PE::Network
 		assert(!"Event's class id is -1, need to add it to global registry");
 	}
 
-	dataSize += StreamManager::WriteInt32(classId, &back.m_payload[dataSize]);
+	dataSize += StreamManager::WriteInt32(classId, &out_packed.m_payload[dataSize]);
 	
-	dataSize += pNetworkableEvent->packCreationData(&back.m_payload[dataSize]);
-	
-	back.m_size = dataSize;
+	dataSize += pNetworkableEvent->packCreationData(&out_packed.m_payload[dataSize]);
 	
+	out_packed.m_size = dataSize;
+}
+
+void EventManager::schedulePackedEvent(const EventTransmissionData &packed, bool guaranteed)
+{
+	if (haveEventsToSend() >= PE_MAX_EVENT_JAM)
+	{
+		assert(!"Sending too many events have to drop, need throttling mechanism here");
+		return;
+	}
+
+	m_eventsToSend.push_back(packed);
+	EventTransmissionData &back = m_eventsToSend.back();
+
+	back.m_isGuaranteed = guaranteed;
+	if (!guaranteed)
+		back.m_orderId = 0; // zero means not guaranteed
+	else
+		back.m_orderId = m_transmitterNextEvtOrderId++;
+
+	// debug info to show event id sceduled
+	//PEINFO("Scheduling event order id: %d\n", m_transmitterNextEvtOrderId);
+
+	//write ordering id (0 = not guaranteed) in front of the packed event
+	StreamManager::WriteInt32(back.m_orderId, &back.m_payload[0]);
 }
 
 int EventManager::haveEventsToSend()
 {
-	return m_eventsToSend.size() > 0;
+	return (int)(m_eventsToSend.size());
 }
 
 int EventManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore)
@@ -114,10 +145,10 @@ int EventManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecor
 	out_usefulDataSent = false;
     out_wantToSendMore = false;
 
-	int eventsToSend = haveEventsToSend();
-	assert(eventsToSend);
+	int eventsToSend = haveEventsToSend(); // can be 0 if packet is sent for other managers, then we just write 0 events
 
 	int eventsReallySent = 0;
+	int eventsKept = 0; // events held back are moved to the front of the queue in order
 
 	int size = 0;
 	size += StreamManager::WriteInt32(eventsToSend, &pDataStream[size]);
@@ -130,12 +161,26 @@ int EventManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecor
 		assert(iEvt < (int)(m_eventsToSend.size()));
 		EventTransmissionData &evt = m_eventsToSend[iEvt];
 
-		if (evt.m_size > sizeLeft)
+		bool send = !out_wantToSendMore;
+		if (send && evt.m_isGuaranteed && evt.m_orderId - m_transmitterFirstNotAckedOrderId >= PE_EVENT_SLIDING_WINDOW)
+		{
+			// receiver would have to discard it. waits until older events are acknowledged
+			send = false;
+		}
+		else if (send && evt.m_size > sizeLeft)
 		{
-			// can't fit this event, break out
+			// can't fit this event, the rest waits for next packet
 			// note this code can be optimized to include next events that can potentailly fit in
             out_wantToSendMore = true;
-			break;
+			send = false;
+		}
+
+		if (!send)
+		{
+			if (eventsKept != iEvt)
+				m_eventsToSend[eventsKept] = evt;
+			eventsKept++;
+			continue;
 		}
 
 		// store this to be able to resolve which events were delivered or dropped on transmittion notification
@@ -157,7 +202,7 @@ int EventManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecor
 	
 	if (eventsReallySent > 0)
 	{
-		m_eventsToSend.erase(m_eventsToSend.begin(), m_eventsToSend.begin() + eventsReallySent);
+		m_eventsToSend.resize(eventsKept);
 	}
 	
 	//write real value into the beginning of event chunk
@@ -171,21 +216,40 @@ int EventManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecor
 
 void EventManager::processNotification(TransmissionRecord *pTransmittionRecord, bool delivered)
 {
-	for (unsigned int i = 0; i < pTransmittionRecord->m_sentEvents.size(); ++i)
+	// walked backwards so that lost events pushed to front of queue end up in the order they were sent
+	for (int i = (int)(pTransmittionRecord->m_sentEvents.size()) - 1; i >= 0; --i)
 	{
 		EventTransmissionData &evt = pTransmittionRecord->m_sentEvents[i];
 
+		if (delivered)
+		{
+			// the other side has the strings defined in this event, further uses send only ids
+			for (int iDef = 0; iDef < evt.m_numStringDefinitions; ++iDef)
+				m_stringTable.acknowledge(evt.m_stringDefinitions[iDef]);
+		}
+
 		if (evt.m_isGuaranteed)
 		{
 			if (delivered)
 			{
 				//we're good, can pop this event off front
 				m_transmitterNumEventsNotAcked--; // will advance sliding window
+
+				// resent copies of events that were already acknowledged are below the window
+				int index = evt.m_orderId - m_transmitterFirstNotAckedOrderId;
+				if (index >= 0 && index < PE_EVENT_SLIDING_WINDOW)
+					m_transmitterAcked[evt.m_orderId % PE_EVENT_SLIDING_WINDOW] = true;
+
+				while (m_transmitterAcked[m_transmitterFirstNotAckedOrderId % PE_EVENT_SLIDING_WINDOW])
+				{
+					m_transmitterAcked[m_transmitterFirstNotAckedOrderId % PE_EVENT_SLIDING_WINDOW] = false;
+					m_transmitterFirstNotAckedOrderId++;
+				}
 			}
 			else
 			{
 				// need to readjust our sliding window and make sure we start sending events starting at at least this event
-				assert(!"Not supported for now!");
+				// receiver accepts events out of order within its sliding window
 				m_eventsToSend.push_front(evt);
 				m_transmitterNumEventsNotAcked--; // will advance sliding window since we need to resend this event
 			}
@@ -201,6 +265,7 @@ void EventManager::processNotification(TransmissionRecord *pTransmittionRecord,
 
 void EventManager::debugRender(int &threadOwnershipMask, float xoffset/* = 0*/, float yoffset/* = 0*/)
 {
+#if !PE_NETWORKING_HEADLESS
 	float dy = 0.025f;
 	float dx = 0.01f;
 	sprintf(PEString::s_buf, "Event Manager:");
@@ -243,6 +308,14 @@ void EventManager::debugRender(int &threadOwnershipMask, float xoffset/* = 0*/,
 		PEString::s_buf, true, false, false, false, 0,
 		Vector3(xoffset + dx, yoffset + dy * 3, 0), 1.0f, threadOwnershipMask);
 
+	CongestionController &congestion = m_pNetContext->getStreamManager()->getCongestionController();
+	sprintf(PEString::s_buf, "RTT: %.0f ms +- %.0f Loss: %.1f%% Rate: %.1f/%d pps",
+		congestion.getSrtt() * 1000.0f, congestion.getRttVar() * 1000.0f, congestion.getLossRate() * 100.0f,
+		congestion.getSendRate(), m_pNetContext->getStreamManager()->getPacketRate());
+	DebugRenderer::Instance()->createTextMesh(
+		PEString::s_buf, true, false, false, false, 0,
+		Vector3(xoffset + dx, yoffset + dy * 4, 0), 1.0f, threadOwnershipMask);
+#endif
 }
 
 
@@ -253,6 +326,10 @@ int EventManager::receiveNextPacket(char *pDataStream)
 	
 	read += StreamManager::ReadInt32(&pDataStream[read], numEvents);
 
+	// net strings in events resolve through this connection's table
+	// (restored on return, handlers that schedule events on other connections set their own)
+	StreamManager::ActiveStringTableScope stringTableScope(&m_stringTable);
+
 	for (int i = 0; i < numEvents; ++i)
 	{
 		PrimitiveTypes::Int32 evtOrderId;
@@ -262,6 +339,7 @@ int EventManager::receiveNextPacket(char *pDataStream)
 		read += StreamManager::ReadNetworkId(&pDataStream[read], networkId);
 		Networkable *pTargetNetworkable = NULL;
 		Component *pTargetComponent = NULL;
+		NetworkEventBatchHandler *pBatchHandler = NULL;
 
 		// todo: retrieve object to send event to
 		if ((pTargetNetworkable = m_pContext->getNetworkManager()->getNetworkableObject(networkId)))
@@ -271,6 +349,7 @@ int EventManager::receiveNextPacket(char *pDataStream)
 			{
 				//can safely case to component
 				pTargetComponent = (Component*)(pTargetNetworkable->getPointerToMainClass());
+				pBatchHandler = m_pContext->getNetworkManager()->getNetworkableBatchHandler(networkId);
 			}
 			else
 			{
@@ -279,7 +358,9 @@ int EventManager::receiveNextPacket(char *pDataStream)
 		}
 		else
 		{
-			assert(!"Network id was not registered with any object! Event will be dismissed");
+			// stale or unknown id. the object was unregistered while event was in flight
+			// we still need to read the event out of the stream, it will be dismissed
+			PEINFO("PE: Warning: Received event for unknown network id %d. Event will be dismissed\n", (int)(networkId));
 		}
 
 		PrimitiveTypes::Int32 classId;
@@ -313,8 +394,7 @@ int EventManager::receiveNextPacket(char *pDataStream)
 			int indexInEventsArray = evtOrderId - m_receiverFirstEvtOrderId;
 			if (indexInEventsArray < 0)
 			{
-				// received an old event, discard
-				PEASSERT(false, "Received event order id %d that precedes current sliding window currently starting at %d. We dont support this situation (old events)\n", evtOrderId, m_receiverFirstEvtOrderId);
+				// old event, already processed. sender resends events whose packet fell out of ack window even if it was delivered
 				delete pEvt;
 			}
 			else if (indexInEventsArray >= PE_EVENT_SLIDING_WINDOW)
@@ -326,26 +406,42 @@ int EventManager::receiveNextPacket(char *pDataStream)
 			}
 			else if (m_receivedEvents[indexInEventsArray].m_pEvent)
 			{
-				// this event has already been received. discard
-				PEASSERT(false, "Received event order id %d that has already been received We dont support this situation\n", evtOrderId);
+				// this event has already been received (resent copy), discard
 				delete pEvt;
 			}
 			else
 			{
 				m_receivedEvents[indexInEventsArray].m_pEvent = pEvt;
 				m_receivedEvents[indexInEventsArray].m_pTargetComponent = pTargetComponent;
+				m_receivedEvents[indexInEventsArray].m_classId = classId;
+				m_receivedEvents[indexInEventsArray].m_pBatchHandler = NULL; // ordered events are always dispatched individually
 			}
 
 		}
+		else if (m_groupUnguaranteedEvents && pTargetComponent)
+		{
+			// not guaranteed, no ordering requirement. gather and dispatch once whole packet is read
+			EventReceptionData data;
+			data.m_pTargetComponent = pTargetComponent;
+			data.m_pEvent = pEvt;
+			data.m_classId = classId;
+			data.m_pBatchHandler = pBatchHandler;
+			data.m_arrivalIndex = (int)(m_groupedEvents.size());
+			m_groupedEvents.push_back(data);
+		}
 		else
 		{
 			// this is not guaranteed event (execute and forget)
-			pTargetComponent->handleEvent(pEvt);
+			if (pTargetComponent)
+				pTargetComponent->handleEvent(pEvt);
 
 			delete pEvt;
 		}
 	}
 
+	if (m_groupedEvents.size())
+		dispatchGroupedEvents();
+
 	// check receiver sliding window and process events if have events for needed order ids
 
 	int numProcessed = 0;
@@ -353,7 +449,9 @@ int EventManager::receiveNextPacket(char *pDataStream)
 	{
 		if (m_receivedEvents[indexInEventsArray].m_pEvent)
 		{
-			m_receivedEvents[indexInEventsArray].m_pTargetComponent->handleEvent(m_receivedEvents[indexInEventsArray].m_pEvent);
+			// target can be null if it was unregistered. we still advance the window past this event
+			if (m_receivedEvents[indexInEventsArray].m_pTargetComponent)
+				m_receivedEvents[indexInEventsArray].m_pTargetComponent->handleEvent(m_receivedEvents[indexInEventsArray].m_pEvent);
 			numProcessed++;
 			delete m_receivedEvents[indexInEventsArray].m_pEvent;
 		}
@@ -374,6 +472,55 @@ int EventManager::receiveNextPacket(char *pDataStream)
 	return read;
 }
 
+static bool GroupedEventLess(const EventReceptionData &a, const EventReceptionData &b)
+{
+	if (a.m_pTargetComponent != b.m_pTargetComponent)
+		return a.m_pTargetComponent < b.m_pTargetComponent;
+	if (a.m_classId != b.m_classId)
+		return a.m_classId < b.m_classId;
+	return a.m_arrivalIndex < b.m_arrivalIndex;
+}
+
+void EventManager::dispatchGroupedEvents()
+{
+	// arrival index keeps wire order of events of same target and class. std::stable_sort would allocate every packet
+	std::sort(m_groupedEvents.begin(), m_groupedEvents.end(), GroupedEventLess);
+
+	unsigned int groupStart = 0;
+	while (groupStart < m_groupedEvents.size())
+	{
+		EventReceptionData &first = m_groupedEvents[groupStart];
+		unsigned int groupEnd = groupStart + 1;
+		while (groupEnd < m_groupedEvents.size()
+			&& m_groupedEvents[groupEnd].m_pTargetComponent == first.m_pTargetComponent
+			&& m_groupedEvents[groupEnd].m_classId == first.m_classId)
+		{
+			++groupEnd;
+		}
+
+		if (first.m_pBatchHandler)
+		{
+			m_eventBatch.clear();
+			for (unsigned int i = groupStart; i < groupEnd; ++i)
+				m_eventBatch.push_back(m_groupedEvents[i].m_pEvent);
+
+			first.m_pBatchHandler->handleEventBatch(&m_eventBatch[0], (int)(m_eventBatch.size()));
+		}
+		else
+		{
+			for (unsigned int i = groupStart; i < groupEnd; ++i)
+				m_groupedEvents[i].m_pTargetComponent->handleEvent(m_groupedEvents[i].m_pEvent);
+		}
+
+		for (unsigned int i = groupStart; i < groupEnd; ++i)
+			delete m_groupedEvents[i].m_pEvent;
+
+		groupStart = groupEnd;
+	}
+
+	m_groupedEvents.clear();
+}
+
 #if 0 // template
 //////////////////////////////////////////////////////////////////////////
 // ConnectionManager Lua Interface
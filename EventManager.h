@@ -23,6 +23,7 @@ extern "C"
 
 // Sibling/Children includes
 #include "Packet.h"
+#include "NetworkingConfig.h"
 
 namespace PE {
 namespace Components {
@@ -44,6 +45,13 @@ struct EventManager : public Component
 	/// called by gameplay code to schedule event transmission to client(s)
 	void scheduleEvent(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, bool guaranteed);
 
+	/// packs event once so that it can be scheduled on many connections without serializing it again
+	/// no string table is active here, net strings of the event are sent in full
+	static void PackEvent(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, EventTransmissionData &out_packed);
+
+	/// schedules event packed by PackEvent(). order id is filled in per connection
+	void schedulePackedEvent(const EventTransmissionData &packed, bool guaranteed);
+
 	/// called by stream manager to see how many events to send
 	int haveEventsToSend();
 
@@ -56,6 +64,12 @@ struct EventManager : public Component
 	void debugRender(int &threadOwnershipMask, float xoffset = 0, float yoffset = 0);
 
 	int receiveNextPacket(char *pDataStream);
+
+	/// when enabled, unguaranteed events of a received packet are gathered and dispatched
+	/// grouped by target component and event class instead of in wire order
+	void setGroupedDispatch(bool enabled){m_groupUnguaranteedEvents = enabled;}
+
+	void dispatchGroupedEvents();
 	
 	// Component ------------------------------------------------------------
 	virtual void addDefaultComponents();
@@ -84,6 +98,9 @@ struct EventManager : public Component
 	// transmitter
 	int m_transmitterNextEvtOrderId;
 	int m_transmitterNumEventsNotAcked; //= number of events stored in TransmissionRecords
+	// guaranteed events are sent only within receiver's sliding window: order id < first not acked + PE_EVENT_SLIDING_WINDOW
+	int m_transmitterFirstNotAckedOrderId;
+	bool m_transmitterAcked[PE_EVENT_SLIDING_WINDOW]; // indexed by order id % PE_EVENT_SLIDING_WINDOW
 
 
 	// receiver
@@ -91,6 +108,13 @@ struct EventManager : public Component
 
 	EventReceptionData m_receivedEvents[PE_EVENT_SLIDING_WINDOW];
 
+	// grouped dispatch of unguaranteed events
+	bool m_groupUnguaranteedEvents;
+	std::vector<EventReceptionData> m_groupedEvents; // kept between packets to avoid reallocation
+	std::vector<Events::Event *> m_eventBatch;
+
+	// strings interned on this connection (StreamManager::WriteNetString/ReadNetString)
+	NetStringTable m_stringTable;
 
 	PE::NetworkContext *m_pNetContext;
 };
@@ -22,7 +22,7 @@ extern "C"
 #include "PrimeEngine/Utils/Networkable.h"
 
 // Sibling/Children includes
-
+#include "NetStringTable.h"
 
 namespace PE {
 	namespace Components
@@ -40,12 +40,30 @@ struct EventTransmissionData
 	int m_size;
 	int m_orderId;
 	char m_payload[PE_MAX_EVENT_PAYLOAD];
+
+	// net strings defined in payload, acknowledged in string table when event is delivered
+	int m_numStringDefinitions;
+	PrimitiveTypes::Int16 m_stringDefinitions[PE_MAX_EVENT_STRING_DEFINITIONS];
+};
+
+// optional interface for components that want to receive unguaranteed network events in bulk
+// is registered per networkable with NetworkManager::setNetworkableBatchHandler()
+// and only used when grouped dispatch is enabled on EventManager
+struct NetworkEventBatchHandler
+{
+	virtual ~NetworkEventBatchHandler() {}
+
+	// all events in the batch are of the same class and target the same component
+	virtual void handleEventBatch(PE::Events::Event **ppEvents, int numEvents) = 0;
 };
 
 struct EventReceptionData
 {
 	Components::Component *m_pTargetComponent;
 	PE::Events::Event *m_pEvent;
+	PrimitiveTypes::Int32 m_classId; // used to group events for dispatch
+	NetworkEventBatchHandler *m_pBatchHandler;
+	int m_arrivalIndex; // position in packet, keeps wire order of events in same group when sorting
 };
 
 }; // namespace PE
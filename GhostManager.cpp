@@ -0,0 +1,757 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "GhostManager.h"
+
+// Outer-Engine includes
+#include <algorithm>
+#include <math.h>
+
+// Inter-Engine includes
+
+#if !PE_NETWORKING_HEADLESS
+#include "../Lua/LuaEnvironment.h"
+#endif
+
+// additional lua includes needed
+extern "C"
+{
+#include "../../luasocket_dist/src/socket.h"
+#include "../../luasocket_dist/src/inet.h"
+};
+
+#include "../../../GlobalConfig/GlobalConfig.h"
+
+#include "PrimeEngine/Events/StandardEvents.h"
+#include "PrimeEngine/Networking/NetworkManager.h"
+
+#if !PE_NETWORKING_HEADLESS
+#include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
+
+#include "StreamManager.h"
+// Sibling/Children includes
+using namespace PE::Events;
+
+namespace PE {
+namespace Components {
+
+PE_IMPLEMENT_CLASS1(GhostManager, Component);
+
+GhostManager::GhostManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself)
+: Component(context, arena, hMyself)
+, m_numGhostsDirty(0)
+, m_nextScopeEpoch(1)
+, m_relevanceFunction(&GhostManager::UniformRelevance)
+, m_packetGhostBudget(0)
+, m_lastReceivedServerTime(0)
+{
+	m_pNetContext = &netContext;
+}
+
+GhostManager::~GhostManager()
+{
+	for (unsigned int i = 0; i < m_ghosts.size(); ++i)
+		delete m_ghosts[i].m_pSnapshots;
+
+	for (unsigned int i = 0; i < m_remoteGhosts.size(); ++i)
+		delete m_remoteGhosts[i].m_pSnapshots;
+}
+
+void GhostManager::initialize()
+{
+
+}
+
+void GhostManager::addDefaultComponents()
+{
+	Component::addDefaultComponents();
+}
+
+double GhostManager::getLocalTime()
+{
+	return m_pContext->getNetworkManager()->getNetworkTime();
+}
+
+int GhostManager::findGhost(Networkable::NetworkId networkId)
+{
+	PrimitiveTypes::UInt32 slotIndex = NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_ghostIndexBySlot.size())
+		return -1;
+
+	int iGhost = m_ghostIndexBySlot[slotIndex];
+	if (iGhost < 0 || m_ghosts[iGhost].m_networkId != networkId)
+		return -1; // slot is ghosting a different generation
+
+	return iGhost;
+}
+
+int GhostManager::findRemoteGhost(Networkable::NetworkId networkId)
+{
+	PrimitiveTypes::UInt32 slotIndex = NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_remoteGhostIndexBySlot.size())
+		return -1;
+
+	int iGhost = m_remoteGhostIndexBySlot[slotIndex];
+	if (iGhost < 0 || m_remoteGhosts[iGhost].m_networkId != networkId)
+		return -1;
+
+	return iGhost;
+}
+
+void GhostManager::removeRemoteGhost(int iRemote)
+{
+	RemoteGhostRecord &remote = m_remoteGhosts[iRemote];
+	m_remoteGhostIndexBySlot[NetworkManager::NetworkIdIndex(remote.m_networkId)] = -1;
+	delete remote.m_pSnapshots;
+
+	// swap with last to keep array dense
+	int iLast = (int)(m_remoteGhosts.size()) - 1;
+	if (iRemote != iLast)
+	{
+		m_remoteGhosts[iRemote] = m_remoteGhosts[iLast];
+		m_remoteGhostIndexBySlot[NetworkManager::NetworkIdIndex(m_remoteGhosts[iRemote].m_networkId)] = iRemote;
+	}
+	m_remoteGhosts.pop_back();
+}
+
+void GhostManager::ghostObject(Networkable::NetworkId networkId, NetGhostable *pGhostable)
+{
+	assert(findGhost(networkId) < 0);
+
+	// came back in scope before the other side was told it left. new scope epoch resets it on the other side
+	for (unsigned int i = 0; i < m_pendingScopeExits.size(); ++i)
+	{
+		if (m_pendingScopeExits[i] == networkId)
+		{
+			m_pendingScopeExits.erase(m_pendingScopeExits.begin() + i);
+			break;
+		}
+	}
+
+	int numFields = pGhostable->ghost_getNumFields();
+	assert(numFields > 0 && numFields <= PE_GHOST_MAX_FIELDS);
+
+	PrimitiveTypes::UInt32 slotIndex = NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_ghostIndexBySlot.size())
+		m_ghostIndexBySlot.resize(slotIndex + 1, -1);
+
+	GhostRecord ghost;
+	ghost.m_pGhostable = pGhostable;
+	ghost.m_networkId = networkId;
+	ghost.m_dirtyMask = numFields == 32 ? 0xffffffff : ((1u << numFields) - 1); // whole state goes out first
+	ghost.m_priority = 0;
+	ghost.m_sequence = 0;
+	ghost.m_scopeEpoch = m_nextScopeEpoch++;
+	ghost.m_pSnapshots = new GhostSnapshotHistory(); // no baseline yet, first update will be full state
+
+	m_ghostIndexBySlot[slotIndex] = (int)(m_ghosts.size());
+	m_ghosts.push_back(ghost);
+	m_numGhostsDirty++;
+}
+
+void GhostManager::unghostObject(Networkable::NetworkId networkId)
+{
+	int iGhost = findGhost(networkId);
+	if (iGhost < 0)
+		return;
+
+	if (m_ghosts[iGhost].m_dirtyMask)
+		m_numGhostsDirty--;
+
+	delete m_ghosts[iGhost].m_pSnapshots;
+
+	// swap with last to keep array dense
+	int iLast = (int)(m_ghosts.size()) - 1;
+	if (iGhost != iLast)
+	{
+		m_ghosts[iGhost] = m_ghosts[iLast];
+		m_ghostIndexBySlot[NetworkManager::NetworkIdIndex(m_ghosts[iGhost].m_networkId)] = iGhost;
+	}
+	m_ghosts.pop_back();
+	m_ghostIndexBySlot[NetworkManager::NetworkIdIndex(networkId)] = -1;
+
+	m_pendingScopeExits.push_back(networkId);
+}
+
+void GhostManager::setMaskBits(Networkable::NetworkId networkId, PrimitiveTypes::UInt32 mask)
+{
+	int iGhost = findGhost(networkId);
+	if (iGhost < 0)
+		return; // not ghosted to this connection
+
+	GhostRecord &ghost = m_ghosts[iGhost];
+	if (!ghost.m_dirtyMask && mask)
+		m_numGhostsDirty++;
+	ghost.m_dirtyMask |= mask;
+}
+
+int GhostManager::haveGhostsToSend()
+{
+	return m_numGhostsDirty + (int)(m_pendingScopeExits.size());
+}
+
+// writes bytes of field that differ from baseline: a bit per byte telling whether it changed, then changed bytes xor-ed with baseline
+static int WriteFieldDelta(const char *pField, const char *pBaseline, int fieldSize, char *pDataStream)
+{
+	int flagBytes = (fieldSize + 7) / 8;
+	memset(pDataStream, 0, flagBytes);
+
+	int size = flagBytes;
+	for (int i = 0; i < fieldSize; ++i)
+	{
+		char x = pField[i] ^ pBaseline[i];
+		if (x)
+		{
+			pDataStream[i / 8] |= (char)(1 << (i % 8));
+			pDataStream[size++] = x;
+		}
+	}
+	return size;
+}
+
+// returns -1 if delta doesn't fit in dataSizeLeft
+static int ReadFieldDelta(char *pDataStream, int dataSizeLeft, const char *pBaseline, int fieldSize, char *out_pField)
+{
+	int flagBytes = (fieldSize + 7) / 8;
+	if (flagBytes > dataSizeLeft)
+		return -1;
+
+	int read = flagBytes;
+	for (int i = 0; i < fieldSize; ++i)
+	{
+		if (!(pDataStream[i / 8] & (1 << (i % 8))))
+			out_pField[i] = pBaseline[i];
+		else if (read < dataSizeLeft)
+			out_pField[i] = pBaseline[i] ^ pDataStream[read++];
+		else
+			return -1;
+	}
+	return read;
+}
+
+void GhostManager::packSnapshot(NetGhostable *pGhostable, GhostSnapshot &out_snapshot)
+{
+	out_snapshot.m_numFields = pGhostable->ghost_getNumFields();
+
+	int offset = 0;
+	for (int field = 0; field < out_snapshot.m_numFields; ++field)
+	{
+		out_snapshot.m_fieldOffset[field] = (PrimitiveTypes::Int16)(offset);
+		offset += pGhostable->ghost_packField(field, &out_snapshot.m_data[offset]);
+		assert(offset <= PE_GHOST_MAX_UPDATE_SIZE);
+	}
+	out_snapshot.m_fieldOffset[out_snapshot.m_numFields] = (PrimitiveTypes::Int16)(offset);
+}
+
+float GhostManager::UniformRelevance(NetGhostable *pGhostable, const GhostViewpoint &viewpoint)
+{
+	return 1.0f;
+}
+
+float GhostManager::DistanceAndViewRelevance(NetGhostable *pGhostable, const GhostViewpoint &viewpoint)
+{
+	Vector3 pos = pGhostable->ghost_getPosition();
+	float dx = pos.m_x - viewpoint.m_position.m_x;
+	float dy = pos.m_y - viewpoint.m_position.m_y;
+	float dz = pos.m_z - viewpoint.m_position.m_z;
+	float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	// closer objects are more relevant. 10 units away = half as relevant as right next to viewer
+	float relevance = 1.0f / (1.0f + dist * 0.1f);
+
+	// objects in front of viewer matter more than ones behind
+	float dot = dx * viewpoint.m_direction.m_x + dy * viewpoint.m_direction.m_y + dz * viewpoint.m_direction.m_z;
+	if (dot > 0)
+		relevance *= 2.0f;
+
+	return relevance;
+}
+
+void GhostManager::accumulatePriorities()
+{
+	for (unsigned int iGhost = 0; iGhost < m_ghosts.size(); ++iGhost)
+	{
+		GhostRecord &ghost = m_ghosts[iGhost];
+		if (ghost.m_dirtyMask)
+			ghost.m_priority += m_relevanceFunction(ghost.m_pGhostable, m_viewpoint);
+	}
+}
+
+struct GhostPriorityGreater
+{
+	GhostPriorityGreater(std::vector<GhostManager::GhostRecord> &ghosts) : m_ghosts(ghosts) {}
+	bool operator()(int a, int b) const {return m_ghosts[a].m_priority > m_ghosts[b].m_priority;}
+	std::vector<GhostManager::GhostRecord> &m_ghosts;
+};
+
+int GhostManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore)
+{
+	out_usefulDataSent = false;
+	out_wantToSendMore = false;
+
+	int ghostsReallySent = 0;
+
+	int size = 0;
+
+	// time updates are sent at (milliseconds), receiver stamps snapshots with it
+	size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(getLocalTime() * 1000.0), &pDataStream[size]);
+
+	int numUpdatesOffset = size;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]); // number of updates, written at the end
+
+	// ghost budget includes the time and count we just wrote
+	if (m_packetGhostBudget > 0 && m_packetGhostBudget < packetSizeAllocated)
+		packetSizeAllocated = m_packetGhostBudget;
+
+	// leave space for scope exit count
+	int updatesSizeAllocated = packetSizeAllocated - sizeof(PrimitiveTypes::Int32);
+
+	// highest priority first
+	m_sendOrder.clear();
+	for (unsigned int iGhost = 0; iGhost < m_ghosts.size(); ++iGhost)
+	{
+		if (m_ghosts[iGhost].m_dirtyMask)
+			m_sendOrder.push_back(iGhost);
+	}
+	std::sort(m_sendOrder.begin(), m_sendOrder.end(), GhostPriorityGreater(m_ghosts));
+
+	for (unsigned int iOrder = 0; iOrder < m_sendOrder.size(); ++iOrder)
+	{
+		GhostRecord &ghost = m_ghosts[m_sendOrder[iOrder]];
+
+		if (updatesSizeAllocated - size < (int)(sizeof(PrimitiveTypes::Int32)) * 5)
+		{
+			// budget is exhausted, lower priority ghosts keep accumulating
+			out_wantToSendMore = true;
+			break;
+		}
+
+		GhostSnapshot &current = m_currentSnapshot;
+		packSnapshot(ghost.m_pGhostable, current);
+
+		// baseline is usable only if receiver still has it in its history
+		// receiver got at most as many updates as we sent since the baseline
+		GhostSnapshot &baseline = ghost.m_pSnapshots->m_baseline;
+		bool useBaseline = baseline.m_packetId != 0
+			&& ghost.m_sequence - baseline.m_sequence < PE_GHOST_SNAPSHOT_HISTORY
+			&& baseline.m_numFields == current.m_numFields;
+
+		// send fields that differ from what the other side has
+		PrimitiveTypes::UInt32 mask = 0;
+		for (int field = 0; field < current.m_numFields; ++field)
+		{
+			if (!useBaseline
+				|| baseline.fieldSize(field) != current.fieldSize(field)
+				|| memcmp(&baseline.m_data[baseline.m_fieldOffset[field]], &current.m_data[current.m_fieldOffset[field]], current.fieldSize(field)))
+			{
+				mask |= 1u << field;
+			}
+		}
+
+		if (!mask && useBaseline && ghost.m_sequence != baseline.m_sequence)
+		{
+			// a newer update is still in flight. if state went back to baseline, fields that differ from it must go out
+			// again, otherwise the other side is left with the in-flight state once it arrives
+			GhostSnapshot &latest = ghost.m_pSnapshots->m_history[ghost.m_sequence % PE_GHOST_SNAPSHOT_HISTORY];
+			for (int field = 0; field < current.m_numFields; ++field)
+			{
+				if (latest.m_numFields != current.m_numFields
+					|| latest.fieldSize(field) != current.fieldSize(field)
+					|| memcmp(&latest.m_data[latest.m_fieldOffset[field]], &current.m_data[current.m_fieldOffset[field]], current.fieldSize(field)))
+				{
+					mask |= 1u << field;
+				}
+			}
+		}
+
+		if (!mask)
+		{
+			// other side already has this state, or will have it once the update in flight arrives (a lost one flags ghost again)
+			ghost.m_dirtyMask = 0;
+			ghost.m_priority = 0;
+			m_numGhostsDirty--;
+			continue;
+		}
+
+		int dataSize = 0;
+		for (int field = 0; field < current.m_numFields; ++field)
+		{
+			if (!(mask & (1u << field)))
+				continue;
+
+			PrimitiveTypes::Int16 fieldSize = (PrimitiveTypes::Int16)(current.fieldSize(field));
+			dataSize += StreamManager::WriteInt16(fieldSize, &m_scratch[dataSize]);
+
+			char *pField = &current.m_data[current.m_fieldOffset[field]];
+			if (useBaseline && baseline.fieldSize(field) == fieldSize)
+				dataSize += WriteFieldDelta(pField, &baseline.m_data[baseline.m_fieldOffset[field]], fieldSize, &m_scratch[dataSize]);
+			else
+			{
+				memcpy(&m_scratch[dataSize], pField, fieldSize);
+				dataSize += fieldSize;
+			}
+		}
+		assert(dataSize <= (int)(sizeof(m_scratch)));
+
+		int updateSize = sizeof(PrimitiveTypes::Int32) * 5 + dataSize; // id, scope epoch, baseline, mask, data size, data
+		if (updateSize > updatesSizeAllocated - size)
+		{
+			// can't fit this update. smaller ones further in the list might still fit
+			out_wantToSendMore = true;
+			continue;
+		}
+
+		size += StreamManager::WriteNetworkId(ghost.m_networkId, &pDataStream[size]);
+		size += StreamManager::WriteInt32(ghost.m_scopeEpoch, &pDataStream[size]);
+		size += StreamManager::WriteInt32(useBaseline ? baseline.m_packetId : 0, &pDataStream[size]); // 0 = full state
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(mask), &pDataStream[size]);
+		size += StreamManager::WriteInt32(dataSize, &pDataStream[size]);
+		memcpy(&pDataStream[size], m_scratch, dataSize);
+		size += dataSize;
+
+		// keep the state we sent. once this packet is acknowledged it becomes the baseline
+		ghost.m_sequence++;
+		current.m_packetId = pRecord->m_id;
+		current.m_sequence = ghost.m_sequence;
+		ghost.m_pSnapshots->m_history[ghost.m_sequence % PE_GHOST_SNAPSHOT_HISTORY] = current;
+
+		// remember what was sent so that lost fields can be flagged again
+		GhostTransmissionData sent;
+		sent.m_networkId = ghost.m_networkId;
+		sent.m_mask = mask;
+		sent.m_scopeExit = false;
+		pRecord->m_sentGhosts.push_back(sent);
+
+		ghost.m_dirtyMask = 0;
+		ghost.m_priority = 0;
+		m_numGhostsDirty--;
+		ghostsReallySent++;
+	}
+
+	StreamManager::WriteInt32(ghostsReallySent, &pDataStream[numUpdatesOffset]);
+
+	// scope exits follow the updates. they are small and always go out if there is space
+	int exitsCountOffset = size;
+	int exitsReallySent = 0;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]);
+	while (exitsReallySent < (int)(m_pendingScopeExits.size()) && packetSizeAllocated - size >= (int)(sizeof(PrimitiveTypes::Int32)))
+	{
+		Networkable::NetworkId networkId = m_pendingScopeExits[exitsReallySent];
+		size += StreamManager::WriteNetworkId(networkId, &pDataStream[size]);
+
+		GhostTransmissionData sent;
+		sent.m_networkId = networkId;
+		sent.m_mask = 0;
+		sent.m_scopeExit = true;
+		pRecord->m_sentGhosts.push_back(sent);
+
+		exitsReallySent++;
+	}
+	if (exitsReallySent)
+		m_pendingScopeExits.erase(m_pendingScopeExits.begin(), m_pendingScopeExits.begin() + exitsReallySent);
+	if (m_pendingScopeExits.size())
+		out_wantToSendMore = true;
+
+	StreamManager::WriteInt32(exitsReallySent, &pDataStream[exitsCountOffset]);
+
+	// with explicit budget the rest waits for the next tick instead of going out in more packets
+	if (m_packetGhostBudget > 0)
+		out_wantToSendMore = false;
+
+	out_usefulDataSent = ghostsReallySent > 0 || exitsReallySent > 0;
+
+	return size;
+}
+
+void GhostManager::processNotification(TransmissionRecord *pTransmittionRecord, bool delivered)
+{
+	for (unsigned int i = 0; i < pTransmittionRecord->m_sentGhosts.size(); ++i)
+	{
+		GhostTransmissionData &sent = pTransmittionRecord->m_sentGhosts[i];
+
+		if (sent.m_scopeExit)
+		{
+			// resend lost scope exit unless object came back in scope since
+			// (its full state will reset it on the other side and a late exit would remove it again)
+			if (!delivered && findGhost(sent.m_networkId) < 0)
+				m_pendingScopeExits.push_back(sent.m_networkId);
+			continue;
+		}
+
+		if (delivered)
+		{
+			// the other side has the state we sent in this packet, it is our new baseline
+			// (if object was unghosted since, or state is no longer in history, baseline stays)
+			int iGhost = findGhost(sent.m_networkId);
+			if (iGhost < 0)
+				continue;
+
+			GhostSnapshotHistory *pSnapshots = m_ghosts[iGhost].m_pSnapshots;
+			GhostSnapshot *pDelivered = pSnapshots->find(pTransmittionRecord->m_id);
+			if (pDelivered)
+				pSnapshots->m_baseline = *pDelivered;
+		}
+		else
+		{
+			// lost. flag ghost to be sent again, the delta against baseline will include lost fields with their latest values
+			// (if object was unghosted since, this does nothing)
+			setMaskBits(sent.m_networkId, sent.m_mask);
+		}
+	}
+}
+
+int GhostManager::receiveNextPacket(char *pDataStream, int dataSizeLeft)
+{
+	// sizes, masks and counts come from the other side. anything that doesn't fit drops the packet
+	const int updateHeaderSize = sizeof(PrimitiveTypes::Int32) * 5; // id, scope epoch, baseline, mask, data size
+
+	int read = 0;
+	if (dataSizeLeft < (int)(sizeof(PrimitiveTypes::Int32)) * 3) // time, update count, exit count
+	{
+		PEINFO("PE: Warning: Ghost stream is cut off. Packet will be dropped\n");
+		return -1;
+	}
+
+	PrimitiveTypes::Int32 serverTimeMs;
+	read += StreamManager::ReadInt32(&pDataStream[read], serverTimeMs);
+
+	PrimitiveTypes::Int32 numGhosts;
+	read += StreamManager::ReadInt32(&pDataStream[read], numGhosts);
+
+	if (numGhosts < 0 || numGhosts > (dataSizeLeft - read) / updateHeaderSize)
+	{
+		PEINFO("PE: Warning: Received invalid number of ghost updates %d. Packet will be dropped\n", numGhosts);
+		return -1;
+	}
+
+	if (numGhosts)
+	{
+		// only packets with updates are snapshots, others come at irregular times and would distort jitter
+		m_lastReceivedServerTime = serverTimeMs / 1000.0;
+		m_snapshotClock.onSnapshotReceived(m_lastReceivedServerTime, getLocalTime());
+	}
+
+	NetworkManager *pNetworkManager = m_pContext->getNetworkManager();
+	PrimitiveTypes::Int32 packetId = m_pNetContext->getStreamManager()->getLastReceivedPacketId(); // packet being processed
+
+	for (int i = 0; i < numGhosts; ++i)
+	{
+		if (dataSizeLeft - read < updateHeaderSize)
+		{
+			PEINFO("PE: Warning: Ghost update %d is cut off. Packet will be dropped\n", i);
+			return -1;
+		}
+
+		Networkable::NetworkId networkId;
+		read += StreamManager::ReadNetworkId(&pDataStream[read], networkId);
+
+		PrimitiveTypes::Int32 scopeEpoch;
+		read += StreamManager::ReadInt32(&pDataStream[read], scopeEpoch);
+
+		PrimitiveTypes::Int32 baselineId;
+		read += StreamManager::ReadInt32(&pDataStream[read], baselineId);
+
+		PrimitiveTypes::Int32 mask;
+		read += StreamManager::ReadInt32(&pDataStream[read], mask);
+
+		PrimitiveTypes::Int32 dataSize;
+		read += StreamManager::ReadInt32(&pDataStream[read], dataSize);
+
+		if (dataSize < 0 || dataSize > dataSizeLeft - read)
+		{
+			PEINFO("PE: Warning: Ghost %d update has invalid size %d. Packet will be dropped\n", (int)(networkId), dataSize);
+			return -1;
+		}
+
+		NetGhostable *pGhostable = pNetworkManager->getNetworkableGhostable(networkId);
+
+		int iRemote = findRemoteGhost(networkId);
+		if (iRemote >= 0 && m_remoteGhosts[iRemote].m_scopeEpoch != scopeEpoch)
+		{
+			// ghost went out of scope and came back before we were told. start over
+			// (full state of same epoch is just applied below: sender has no acknowledged baseline yet or it aged out)
+			removeRemoteGhost(iRemote);
+			iRemote = -1;
+
+			if (pGhostable)
+				pGhostable->ghost_onScopeExit();
+		}
+
+		if (iRemote < 0)
+		{
+			if (baselineId)
+			{
+				PEINFO("PE: Warning: Received ghost delta for unknown ghost %d. Update will be dismissed\n", (int)(networkId));
+				read += dataSize;
+				continue;
+			}
+
+			// object comes in scope
+			if (pGhostable)
+				pGhostable->ghost_onScopeEnter();
+
+			PrimitiveTypes::UInt32 slotIndex = NetworkManager::NetworkIdIndex(networkId);
+			if (slotIndex >= m_remoteGhostIndexBySlot.size())
+				m_remoteGhostIndexBySlot.resize(slotIndex + 1, -1);
+
+			RemoteGhostRecord remote;
+			remote.m_networkId = networkId;
+			remote.m_sequence = 0;
+			remote.m_scopeEpoch = scopeEpoch;
+			remote.m_pSnapshots = new GhostSnapshotHistory();
+
+			iRemote = (int)(m_remoteGhosts.size());
+			m_remoteGhostIndexBySlot[slotIndex] = iRemote;
+			m_remoteGhosts.push_back(remote);
+		}
+
+		RemoteGhostRecord &remote = m_remoteGhosts[iRemote];
+
+		GhostSnapshot *pBaseline = NULL;
+		if (baselineId)
+		{
+			pBaseline = remote.m_pSnapshots->find(baselineId);
+			if (!pBaseline)
+			{
+				// sender only uses states we acknowledged and that are still in our history. should not happen
+				PEASSERT(false, "Ghost %d baseline %d is not in history. Update will be dismissed\n", (int)(networkId), baselineId);
+				read += dataSize;
+				continue;
+			}
+		}
+
+		// rebuild full state: baseline with changed fields applied
+		GhostSnapshot &current = m_currentSnapshot;
+		current.m_numFields = pBaseline ? pBaseline->m_numFields : 0;
+		for (int field = PE_GHOST_MAX_FIELDS - 1; field >= current.m_numFields; --field)
+		{
+			if ((PrimitiveTypes::UInt32)(mask) & (1u << field))
+			{
+				current.m_numFields = field + 1;
+				break;
+			}
+		}
+
+		int dataRead = 0;
+		int offset = 0;
+		bool valid = true;
+		for (int field = 0; valid && field < current.m_numFields; ++field)
+		{
+			current.m_fieldOffset[field] = (PrimitiveTypes::Int16)(offset);
+
+			if ((PrimitiveTypes::UInt32)(mask) & (1u << field))
+			{
+				PrimitiveTypes::Int16 fieldSize = -1;
+				if (dataSize - dataRead >= (int)(sizeof(PrimitiveTypes::Int16)))
+					dataRead += StreamManager::ReadInt16(&pDataStream[read + dataRead], fieldSize);
+
+				if (fieldSize < 0 || offset + fieldSize > PE_GHOST_MAX_UPDATE_SIZE)
+				{
+					valid = false;
+				}
+				else if (pBaseline && pBaseline->fieldSize(field) == fieldSize)
+				{
+					int deltaSize = ReadFieldDelta(&pDataStream[read + dataRead], dataSize - dataRead, &pBaseline->m_data[pBaseline->m_fieldOffset[field]], fieldSize, &current.m_data[offset]);
+					valid = deltaSize >= 0;
+					dataRead += deltaSize;
+				}
+				else if (fieldSize <= dataSize - dataRead)
+				{
+					memcpy(&current.m_data[offset], &pDataStream[read + dataRead], fieldSize);
+					dataRead += fieldSize;
+				}
+				else
+				{
+					valid = false;
+				}
+				offset += fieldSize;
+			}
+			else if (pBaseline && offset + pBaseline->fieldSize(field) <= PE_GHOST_MAX_UPDATE_SIZE)
+			{
+				int fieldSize = pBaseline->fieldSize(field);
+				memcpy(&current.m_data[offset], &pBaseline->m_data[pBaseline->m_fieldOffset[field]], fieldSize);
+				offset += fieldSize;
+			}
+			else
+			{
+				valid = false; // full state has all fields
+			}
+		}
+
+		if (!valid || dataRead != dataSize)
+		{
+			PEINFO("PE: Warning: Ghost %d update is malformed. Packet will be dropped\n", (int)(networkId));
+			return -1;
+		}
+		current.m_fieldOffset[current.m_numFields] = (PrimitiveTypes::Int16)(offset);
+
+		// keep state, sender may use it as baseline once it learns we received this packet
+		remote.m_sequence++;
+		current.m_packetId = packetId;
+		current.m_sequence = remote.m_sequence;
+		remote.m_pSnapshots->m_history[remote.m_sequence % PE_GHOST_SNAPSHOT_HISTORY] = current;
+
+		if (pGhostable)
+		{
+			for (int field = 0; field < current.m_numFields; ++field)
+			{
+				if ((PrimitiveTypes::UInt32)(mask) & (1u << field))
+					pGhostable->ghost_unpackField(field, &current.m_data[current.m_fieldOffset[field]]);
+			}
+		}
+		else
+		{
+			// object is not (or no longer) known on this side. state is kept so that further deltas can be decoded
+			PEINFO("PE: Warning: Received ghost update for unknown network id %d. Update will not be applied\n", (int)(networkId));
+		}
+
+		read += dataSize;
+	}
+
+	if (dataSizeLeft - read < (int)(sizeof(PrimitiveTypes::Int32)))
+	{
+		PEINFO("PE: Warning: Ghost stream is cut off. Packet will be dropped\n");
+		return -1;
+	}
+
+	PrimitiveTypes::Int32 numExits;
+	read += StreamManager::ReadInt32(&pDataStream[read], numExits);
+
+	if (numExits < 0 || numExits > (dataSizeLeft - read) / (int)(sizeof(PrimitiveTypes::Int32)))
+	{
+		PEINFO("PE: Warning: Received invalid number of ghost scope exits %d. Packet will be dropped\n", numExits);
+		return -1;
+	}
+
+	for (int i = 0; i < numExits; ++i)
+	{
+		Networkable::NetworkId networkId;
+		read += StreamManager::ReadNetworkId(&pDataStream[read], networkId);
+
+		int iRemote = findRemoteGhost(networkId);
+		if (iRemote < 0)
+			continue; // already out of scope
+
+		removeRemoteGhost(iRemote);
+
+		if (NetGhostable *pGhostable = pNetworkManager->getNetworkableGhostable(networkId))
+			pGhostable->ghost_onScopeExit();
+	}
+
+	return read;
+}
+
+void GhostManager::debugRender(int &threadOwnershipMask, float xoffset/* = 0*/, float yoffset/* = 0*/)
+{
+#if !PE_NETWORKING_HEADLESS
+	sprintf(PEString::s_buf, "Ghost Manager: %d ghosts %d dirty, jitter %.1f ms delay %.1f ms", (int)(m_ghosts.size()), m_numGhostsDirty, m_snapshotClock.getJitter() * 1000.0f, m_snapshotClock.getDelay() * 1000.0f);
+	DebugRenderer::Instance()->createTextMesh(
+		PEString::s_buf, true, false, false, false, 0,
+		Vector3(xoffset, yoffset, 0), 1.0f, threadOwnershipMask);
+#endif
+}
+
+}; // namespace Components
+}; // namespace PE
@@ -0,0 +1,162 @@
+#ifndef __PrimeEngineGhostManager_H__
+#define __PrimeEngineGhostManager_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <vector>
+
+// Inter-Engine includes
+
+#include "../Events/Component.h"
+
+extern "C"
+{
+#include "../../luasocket_dist/src/socket.h"
+};
+
+#include "PrimeEngine/Networking/NetworkContext.h"
+#include "PrimeEngine/Utils/Networkable.h"
+
+// Sibling/Children includes
+#include "Packet.h"
+#include "InterpolationBuffer.h"
+#include "NetworkingConfig.h"
+
+namespace PE {
+namespace Components {
+
+// Replicates state of networkable objects over one connection (Tribes ghost manager)
+// Each ghosted object has a dirty mask with one bit per field. Dirty ghosts are sent as a delta against
+// the last state the other side is known to have received (baseline): only fields that differ from
+// the baseline are sent and only bytes of those fields that changed. If there is no usable baseline
+// the full state is sent. Every update carries scope epoch of the ghost, receiver resets its state of a ghost
+// (scope exit + enter) only when epoch changes; full states of a known ghost are just applied. Ghosts of packets that were not delivered are flagged dirty again on notification.
+struct GhostManager : public Component
+{
+	PE_DECLARE_CLASS(GhostManager);
+
+	// Constructor -------------------------------------------------------------
+	GhostManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself);
+
+	virtual ~GhostManager();
+
+	// Methods -----------------------------------------------------------------
+	virtual void initialize();
+
+	/// called by gameplay code to start replicating object over this connection. all fields are sent initially
+	void ghostObject(Networkable::NetworkId networkId, NetGhostable *pGhostable);
+
+	/// called by gameplay code (or interest management) to stop replicating object over this connection
+	/// the other side is notified that object went out of scope
+	void unghostObject(Networkable::NetworkId networkId);
+
+	bool isGhosted(Networkable::NetworkId networkId){return findGhost(networkId) >= 0;}
+
+	/// called by gameplay code when fields of object change
+	void setMaskBits(Networkable::NetworkId networkId, PrimitiveTypes::UInt32 mask);
+
+	/// called by stream manager to see whether there are ghost updates to send
+	int haveGhostsToSend();
+
+	/// called by stream manager once per tick. priority of every dirty ghost grows by its relevance
+	void accumulatePriorities();
+
+	void setViewpoint(const GhostViewpoint &viewpoint){m_viewpoint = viewpoint;}
+	void setRelevanceFunction(GhostRelevanceFunction relevanceFunction){m_relevanceFunction = relevanceFunction;}
+
+	/// limits how many bytes of ghost updates go in one packet. 0 = use all space left in packet
+	void setPacketGhostBudget(int bytes){m_packetGhostBudget = bytes;}
+
+	// relevance functions
+	static float UniformRelevance(NetGhostable *pGhostable, const GhostViewpoint &viewpoint);
+	static float DistanceAndViewRelevance(NetGhostable *pGhostable, const GhostViewpoint &viewpoint);
+
+	/// called by StreamManager to put dirty ghost fields in packet
+	int fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore);
+
+	/// called by StreamManager to process transmission record deliver notification
+	void processNotification(TransmissionRecord *pTransmittionRecord, bool delivered);
+
+	/// dataSizeLeft is what is left of the packet. returns -1 if updates are malformed (rest of packet is dropped)
+	int receiveNextPacket(char *pDataStream, int dataSizeLeft);
+
+	/// time (seconds) of the other side at which the last received ghost updates were sent
+	/// remote entities stamp their snapshots with it, see InterpolationBuffer
+	double getLastReceivedServerTime(){return m_lastReceivedServerTime;}
+
+	/// server time remote entities should be rendered at. trails the server by adaptive delay
+	double getInterpolationTime(){return m_snapshotClock.getRenderTime(getLocalTime());}
+
+	SnapshotClock &getSnapshotClock(){return m_snapshotClock;}
+
+	/// ghost updates are stamped with network time of the sender, see NetworkManager::getNetworkTime()
+	double getLocalTime();
+
+	void debugRender(int &threadOwnershipMask, float xoffset = 0, float yoffset = 0);
+
+	// Component ------------------------------------------------------------
+	virtual void addDefaultComponents();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	struct GhostRecord
+	{
+		NetGhostable *m_pGhostable;
+		Networkable::NetworkId m_networkId;
+		PrimitiveTypes::UInt32 m_dirtyMask; // fields that need to be sent
+		float m_priority; // grows every tick the ghost is dirty and not sent, reset when sent
+		PrimitiveTypes::Int32 m_sequence; // number of updates sent
+		PrimitiveTypes::Int32 m_scopeEpoch; // new for every ghostObject(), sent with updates so that receiver knows object re-entered scope
+		GhostSnapshotHistory *m_pSnapshots; // states sent recently and the acknowledged baseline
+	};
+
+	// ghosts the other side replicates to us
+	struct RemoteGhostRecord
+	{
+		Networkable::NetworkId m_networkId;
+		PrimitiveTypes::Int32 m_sequence; // number of updates received
+		PrimitiveTypes::Int32 m_scopeEpoch; // scope epoch of sender's ghost these updates belong to
+		GhostSnapshotHistory *m_pSnapshots; // states received recently, sender uses them as baselines
+	};
+
+	int findGhost(Networkable::NetworkId networkId);
+	int findRemoteGhost(Networkable::NetworkId networkId);
+	void removeRemoteGhost(int iRemote);
+
+	void packSnapshot(NetGhostable *pGhostable, GhostSnapshot &out_snapshot);
+
+	std::vector<GhostRecord> m_ghosts;
+	std::vector<int> m_ghostIndexBySlot; // networkable slot index -> index in m_ghosts or -1
+
+	std::vector<Networkable::NetworkId> m_pendingScopeExits; // objects that went out of scope, other side is not notified yet
+
+	std::vector<RemoteGhostRecord> m_remoteGhosts;
+	std::vector<int> m_remoteGhostIndexBySlot; // networkable slot index -> index in m_remoteGhosts or -1
+
+	int m_numGhostsDirty;
+	PrimitiveTypes::Int32 m_nextScopeEpoch;
+
+	// prioritization
+	GhostViewpoint m_viewpoint;
+	GhostRelevanceFunction m_relevanceFunction;
+	int m_packetGhostBudget;
+	std::vector<int> m_sendOrder; // dirty ghosts sorted by priority. kept to avoid reallocation
+
+	// timing
+	double m_lastReceivedServerTime;
+	SnapshotClock m_snapshotClock;
+
+	GhostSnapshot m_currentSnapshot; // state being sent/received
+	// encoded update is written here first to see if it fits in packet. delta encoding can add a flag byte per 8 bytes of field and field sizes
+	char m_scratch[PE_GHOST_MAX_UPDATE_SIZE * 2 + PE_GHOST_MAX_FIELDS * 2];
+
+	PE::NetworkContext *m_pNetContext;
+};
+}; // namespace Components
+}; // namespace PE
+#endif
@@ -0,0 +1,111 @@
+#ifndef __PrimeEngineGhostTransmissionData_H__
+#define __PrimeEngineGhostTransmissionData_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+#include "PrimeEngine/Utils/Networkable.h"
+#include "PrimeEngine/Math/Vector3.h"
+#include "PrimeEngine/Math/Matrix4x4.h"
+
+// Sibling/Children includes
+
+
+namespace PE {
+
+// max number of replicated fields of one ghostable object (one bit per field in dirty mask)
+#define PE_GHOST_MAX_FIELDS 32
+
+// max size of all fields of one ghost update
+#define PE_GHOST_MAX_UPDATE_SIZE 512
+
+// interface implemented by objects whose state is replicated by GhostManager
+// object is found on both sides through its network id, see NetworkManager::setNetworkableGhostable()
+struct NetGhostable
+{
+	virtual int ghost_getNumFields() = 0;
+
+	// write/read value of one field, return number of bytes written/read
+	virtual int ghost_packField(int field, char *pDataStream) = 0;
+	virtual int ghost_unpackField(int field, char *pDataStream) = 0;
+
+	// used by relevance functions to prioritize updates and by interest management to scope objects
+	virtual Vector3 ghost_getPosition() {return Vector3(0, 0, 0);}
+
+	// orientation quaternion (x, y, z, w). recorded by server lag compensation history
+	virtual Vector4 ghost_getOrientation() {return Vector4(0, 0, 0, 1.0f);}
+
+	// called on receiving side when object comes in/goes out of scope of this connection
+	// scope enter is called before the fields of first update are unpacked
+	virtual void ghost_onScopeEnter() {}
+	virtual void ghost_onScopeExit() {}
+};
+
+// point of view of the client of a connection. is set by gameplay code on server (e.g. camera of client's car)
+struct GhostViewpoint
+{
+	GhostViewpoint()
+		: m_position(0, 0, 0)
+		, m_direction(0, 0, 1.0f)
+	{}
+
+	Vector3 m_position;
+	Vector3 m_direction; // normalized
+};
+
+// returns how fast priority of a dirty ghost grows per tick for the given viewpoint
+typedef float (*GhostRelevanceFunction)(NetGhostable *pGhostable, const GhostViewpoint &viewpoint);
+
+// stored in TransmissionRecord to know which fields of which ghost were sent in a packet
+struct GhostTransmissionData
+{
+	Networkable::NetworkId m_networkId;
+	PrimitiveTypes::UInt32 m_mask;
+	bool m_scopeExit; // this is not an update but a notification that object went out of scope
+};
+
+// number of recent states of each ghost kept to be used as delta baselines
+#define PE_GHOST_SNAPSHOT_HISTORY 8
+
+// complete packed state of a ghost as of some packet. used as a baseline for delta compression
+struct GhostSnapshot
+{
+	PrimitiveTypes::Int32 m_packetId; // packet this state was sent in. 0 = empty
+	PrimitiveTypes::Int32 m_sequence; // counts updates of this ghost, used to know if snapshot is still in history of receiver
+	int m_numFields;
+	PrimitiveTypes::Int16 m_fieldOffset[PE_GHOST_MAX_FIELDS + 1]; // field i is [m_fieldOffset[i], m_fieldOffset[i + 1])
+	char m_data[PE_GHOST_MAX_UPDATE_SIZE];
+
+	int fieldSize(int field) const {return m_fieldOffset[field + 1] - m_fieldOffset[field];}
+};
+
+struct GhostSnapshotHistory
+{
+	GhostSnapshotHistory()
+	{
+		for (int i = 0; i < PE_GHOST_SNAPSHOT_HISTORY; ++i)
+			m_history[i].m_packetId = 0;
+		m_baseline.m_packetId = 0;
+	}
+
+	GhostSnapshot *find(PrimitiveTypes::Int32 packetId)
+	{
+		for (int i = 0; i < PE_GHOST_SNAPSHOT_HISTORY; ++i)
+		{
+			if (m_history[i].m_packetId == packetId)
+				return &m_history[i];
+		}
+		return NULL;
+	}
+
+	GhostSnapshot m_history[PE_GHOST_SNAPSHOT_HISTORY]; // indexed by sequence % PE_GHOST_SNAPSHOT_HISTORY
+	GhostSnapshot m_baseline; // sender only: latest state the other side is known to have received
+};
+
+}; // namespace PE
+#endif
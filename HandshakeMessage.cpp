@@ -0,0 +1,139 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "HandshakeMessage.h"
+
+// Outer-Engine includes
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+#include "StreamManager.h"
+
+namespace PE {
+
+using namespace Components;
+
+HandshakeMessage::HandshakeMessage(EType type)
+: m_type(type)
+, m_version(PE_HANDSHAKE_VERSION)
+, m_capabilities(0)
+, m_cookie(0)
+, m_packetRate(0)
+, m_maxPacketSize(0)
+, m_ip(0)
+, m_port(0)
+, m_clientId(-1)
+, m_rejectReason(0)
+{}
+
+int HandshakeMessage::write(char *pDataStream)
+{
+	int size = 0;
+	size += StreamManager::WriteInt32(PE_HANDSHAKE_MAGIC, &pDataStream[size]);
+	size += StreamManager::WriteInt16(m_version, &pDataStream[size]);
+	size += StreamManager::WriteInt16((PrimitiveTypes::Int16)(m_type), &pDataStream[size]);
+
+	switch (m_type)
+	{
+	case Type_ConnectRequest:
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_capabilities), &pDataStream[size]);
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_cookie >> 32), &pDataStream[size]);
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_cookie & 0xffffffff), &pDataStream[size]);
+		size += StreamManager::WriteInt16(m_packetRate, &pDataStream[size]);
+		size += StreamManager::WriteInt16(m_maxPacketSize, &pDataStream[size]);
+		break;
+	case Type_Challenge:
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_cookie >> 32), &pDataStream[size]);
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_cookie & 0xffffffff), &pDataStream[size]);
+		break;
+	case Type_Accept:
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_ip), &pDataStream[size]);
+		size += StreamManager::WriteInt16((PrimitiveTypes::Int16)(m_port), &pDataStream[size]);
+		size += StreamManager::WriteInt32(m_clientId, &pDataStream[size]);
+		size += StreamManager::WriteInt32((PrimitiveTypes::Int32)(m_capabilities), &pDataStream[size]);
+		size += StreamManager::WriteInt16(m_packetRate, &pDataStream[size]);
+		size += StreamManager::WriteInt16(m_maxPacketSize, &pDataStream[size]);
+		break;
+	case Type_Reject:
+		size += StreamManager::WriteInt16(m_rejectReason, &pDataStream[size]);
+		break;
+	default:
+		assert(!"Unknown handshake message type");
+	}
+
+	assert(size <= PE_HANDSHAKE_MAX_SIZE);
+	return size;
+}
+
+int HandshakeMessage::read(char *pDataStream, int size)
+{
+	if (size < PE_HANDSHAKE_HEADER)
+		return 0;
+
+	int read = 0;
+	PrimitiveTypes::Int32 magic;
+	read += StreamManager::ReadInt32(&pDataStream[read], magic);
+	if (magic != PE_HANDSHAKE_MAGIC)
+		return 0;
+
+	PrimitiveTypes::Int16 type;
+	read += StreamManager::ReadInt16(&pDataStream[read], m_version);
+	read += StreamManager::ReadInt16(&pDataStream[read], type);
+	if (type < 0 || type >= Type_Count)
+		return 0;
+	m_type = (EType)(type);
+
+	if (m_version != PE_HANDSHAKE_VERSION)
+		return read; // body layout unknown
+
+	PrimitiveTypes::Int32 v32, hi, lo;
+	PrimitiveTypes::Int16 v16;
+
+	switch (m_type)
+	{
+	case Type_ConnectRequest:
+		if (size - read < 16)
+			return 0;
+		read += StreamManager::ReadInt32(&pDataStream[read], v32);
+		m_capabilities = (PrimitiveTypes::UInt32)(v32);
+		read += StreamManager::ReadInt32(&pDataStream[read], hi);
+		read += StreamManager::ReadInt32(&pDataStream[read], lo);
+		m_cookie = ((unsigned long long)(PrimitiveTypes::UInt32)(hi) << 32) | (PrimitiveTypes::UInt32)(lo);
+		read += StreamManager::ReadInt16(&pDataStream[read], m_packetRate);
+		read += StreamManager::ReadInt16(&pDataStream[read], m_maxPacketSize);
+		break;
+	case Type_Challenge:
+		if (size - read < 8)
+			return 0;
+		read += StreamManager::ReadInt32(&pDataStream[read], hi);
+		read += StreamManager::ReadInt32(&pDataStream[read], lo);
+		m_cookie = ((unsigned long long)(PrimitiveTypes::UInt32)(hi) << 32) | (PrimitiveTypes::UInt32)(lo);
+		break;
+	case Type_Accept:
+		if (size - read < 18)
+			return 0;
+		read += StreamManager::ReadInt32(&pDataStream[read], v32);
+		m_ip = (PrimitiveTypes::UInt32)(v32);
+		read += StreamManager::ReadInt16(&pDataStream[read], v16);
+		m_port = (PrimitiveTypes::UInt16)(v16);
+		read += StreamManager::ReadInt32(&pDataStream[read], m_clientId);
+		read += StreamManager::ReadInt32(&pDataStream[read], v32);
+		m_capabilities = (PrimitiveTypes::UInt32)(v32);
+		read += StreamManager::ReadInt16(&pDataStream[read], m_packetRate);
+		read += StreamManager::ReadInt16(&pDataStream[read], m_maxPacketSize);
+		break;
+	case Type_Reject:
+		if (size - read < 2)
+			return 0;
+		read += StreamManager::ReadInt16(&pDataStream[read], m_rejectReason);
+		break;
+	default:
+		return 0;
+	}
+
+	return read;
+}
+
+}; // namespace PE
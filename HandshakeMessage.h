@@ -0,0 +1,78 @@
+#ifndef __PrimeEngineHandshakeMessage_H__
+#define __PrimeEngineHandshakeMessage_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+// every handshake datagram starts with magic, version and message type
+#define PE_HANDSHAKE_MAGIC 0x5045434e // "PECN"
+#define PE_HANDSHAKE_VERSION 1
+#define PE_HANDSHAKE_HEADER 8
+
+// biggest handshake message, datagrams are never bigger than this
+#define PE_HANDSHAKE_MAX_SIZE 64
+
+// capability bits. server answers with capabilities both sides support
+#define PE_HANDSHAKE_CAP_MTU_PROBING 1
+
+namespace PE {
+
+// Binary messages exchanged on server's listening socket before connection is established:
+// client ConnectRequest -> server Challenge (cookie) -> client ConnectRequest with cookie -> server Accept (or Reject).
+// Fields not used by message type are not sent. Encoded with StreamManager primitives.
+struct HandshakeMessage
+{
+	enum EType
+	{
+		Type_ConnectRequest = 0,
+		Type_Challenge,
+		Type_Accept,
+		Type_Reject,
+		Type_Count
+	};
+
+	enum ERejectReason
+	{
+		Reject_Version = 0, // m_version says which version server speaks
+		Reject_ServerFull,
+		Reject_Failed,
+	};
+
+	HandshakeMessage(EType type = Type_ConnectRequest);
+
+	/// returns number of bytes written, at most PE_HANDSHAKE_MAX_SIZE
+	int write(char *pDataStream);
+
+	/// returns number of bytes read, 0 if datagram is not a handshake message or is truncated
+	/// header is read even if version doesn't match so that server can reject with its version
+	int read(char *pDataStream, int size);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	EType m_type;
+	PrimitiveTypes::Int16 m_version;
+
+	PrimitiveTypes::UInt32 m_capabilities; // request: what client supports, accept: what was agreed on
+	unsigned long long m_cookie; // request: echoed cookie, 0 on first request. challenge: cookie to echo
+
+	PrimitiveTypes::Int16 m_packetRate; // request: desired, 0 = server default. accept: negotiated
+	PrimitiveTypes::Int16 m_maxPacketSize;
+
+	PrimitiveTypes::UInt32 m_ip; // accept: endpoint of server socket for this client, network byte order
+	PrimitiveTypes::UInt16 m_port;
+	PrimitiveTypes::Int32 m_clientId;
+
+	PrimitiveTypes::Int16 m_rejectReason;
+};
+
+}; // namespace PE
+#endif
@@ -0,0 +1,140 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "InterpolationBuffer.h"
+
+// Outer-Engine includes
+#include <math.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+SnapshotClock::SnapshotClock()
+: m_synced(false)
+, m_serverTimeOffset(0)
+, m_lastServerTime(0)
+, m_lastTransit(0)
+, m_snapshotInterval(0)
+, m_jitter(0)
+, m_delay(PE_INTERPOLATION_MIN_DELAY * 2.0f)
+{
+}
+
+void SnapshotClock::onSnapshotReceived(double serverTime, double localTime)
+{
+	double transit = localTime - serverTime;
+
+	if (!m_synced || fabs(serverTime - localTime - m_serverTimeOffset) > 1.0)
+	{
+		// first snapshot or clocks went far apart (e.g. long stall): resync
+		m_synced = true;
+		m_serverTimeOffset = serverTime - localTime;
+		m_lastServerTime = serverTime;
+		m_lastTransit = transit;
+		return;
+	}
+
+	if (serverTime <= m_lastServerTime)
+		return; // not newer than what we have
+
+	float d = (float)(fabs(transit - m_lastTransit));
+	m_jitter += (d - m_jitter) / 16.0f;
+
+	float interval = (float)(serverTime - m_lastServerTime);
+	m_snapshotInterval += (interval - m_snapshotInterval) / 16.0f;
+
+	m_serverTimeOffset += ((serverTime - localTime) - m_serverTimeOffset) / 16.0;
+
+	m_lastServerTime = serverTime;
+	m_lastTransit = transit;
+
+	float targetDelay = m_snapshotInterval + PE_INTERPOLATION_JITTER_FACTOR * m_jitter;
+	if (targetDelay < PE_INTERPOLATION_MIN_DELAY)
+		targetDelay = PE_INTERPOLATION_MIN_DELAY;
+	if (targetDelay > PE_INTERPOLATION_MAX_DELAY)
+		targetDelay = PE_INTERPOLATION_MAX_DELAY;
+
+	m_delay += (targetDelay - m_delay) * 0.05f;
+}
+
+InterpolationBuffer::InterpolationBuffer()
+: m_newest(0)
+, m_count(0)
+{
+}
+
+void InterpolationBuffer::addSnapshot(double serverTime, const PrimitiveTypes::Float32 *pValues, int numValues)
+{
+	assert(numValues <= PE_INTERPOLATION_MAX_VALUES);
+
+	if (m_count && serverTime < snapshot(0).m_time)
+		return; // older than newest, interpolation has moved past it
+
+	if (!m_count || serverTime > snapshot(0).m_time)
+	{
+		m_newest = (m_newest + 1) % PE_INTERPOLATION_BUFFER_SIZE;
+		if (m_count < PE_INTERPOLATION_BUFFER_SIZE)
+			++m_count;
+	}
+	// else same time (several updates in one packet), overwrite
+
+	Snapshot &s = snapshot(0);
+	s.m_time = serverTime;
+	s.m_numValues = numValues;
+	for (int i = 0; i < numValues; ++i)
+		s.m_values[i] = pValues[i];
+}
+
+bool InterpolationBuffer::sample(double renderTime, PrimitiveTypes::Float32 *out_values)
+{
+	if (!m_count)
+		return false;
+
+	Snapshot &newest = snapshot(0);
+
+	if (renderTime >= newest.m_time)
+	{
+		if (m_count < 2)
+		{
+			for (int i = 0; i < newest.m_numValues; ++i)
+				out_values[i] = newest.m_values[i];
+			return true;
+		}
+
+		// snapshots are late, extrapolate along the last segment for a limited time
+		Snapshot &prev = snapshot(1);
+		double ahead = renderTime - newest.m_time;
+		if (ahead > PE_INTERPOLATION_MAX_EXTRAPOLATION)
+			ahead = PE_INTERPOLATION_MAX_EXTRAPOLATION;
+		float t = (float)(ahead / (newest.m_time - prev.m_time));
+		for (int i = 0; i < newest.m_numValues; ++i)
+			out_values[i] = newest.m_values[i] + (newest.m_values[i] - prev.m_values[i]) * t;
+		return true;
+	}
+
+	// find the two snapshots around render time, newest first
+	for (int i = 1; i < m_count; ++i)
+	{
+		Snapshot &from = snapshot(i);
+		if (from.m_time <= renderTime)
+		{
+			Snapshot &to = snapshot(i - 1);
+			float t = (float)((renderTime - from.m_time) / (to.m_time - from.m_time));
+			for (int v = 0; v < to.m_numValues; ++v)
+				out_values[v] = from.m_values[v] + (to.m_values[v] - from.m_values[v]) * t;
+			return true;
+		}
+	}
+
+	// render time is older than anything we have
+	Snapshot &oldest = snapshot(m_count - 1);
+	for (int i = 0; i < oldest.m_numValues; ++i)
+		out_values[i] = oldest.m_values[i];
+	return true;
+}
+
+}; // namespace PE
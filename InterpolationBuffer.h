@@ -0,0 +1,93 @@
+#ifndef __PrimeEngineInterpolationBuffer_H__
+#define __PrimeEngineInterpolationBuffer_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+// number of timestamped snapshots kept per remote entity
+#define PE_INTERPOLATION_BUFFER_SIZE 32
+
+// max number of interpolated values of one entity (e.g. position 3 + orientation 4 + velocity 3)
+#define PE_INTERPOLATION_MAX_VALUES 16
+
+// how far past the newest snapshot an entity is extrapolated before it stops (seconds)
+#define PE_INTERPOLATION_MAX_EXTRAPOLATION 0.2f
+
+// limits of interpolation delay (seconds)
+#define PE_INTERPOLATION_MIN_DELAY 0.05f
+#define PE_INTERPOLATION_MAX_DELAY 0.5f
+
+// delay covers snapshot interval plus this many times the measured jitter
+#define PE_INTERPOLATION_JITTER_FACTOR 3.0f
+
+namespace PE {
+
+// Estimates server clock from snapshot timestamps and decides how far behind it remote entities are rendered.
+// Jitter is the smoothed change of transit time between consecutive snapshots (as in RTP, RFC 3550).
+// Render delay is snapshot interval + PE_INTERPOLATION_JITTER_FACTOR * jitter and moves towards its target
+// gradually, so that render time never jumps.
+struct SnapshotClock
+{
+	SnapshotClock();
+
+	/// called by GhostManager for every received packet with ghost updates
+	void onSnapshotReceived(double serverTime, double localTime);
+
+	/// server time entities should be rendered at
+	double getRenderTime(double localTime){return localTime + m_serverTimeOffset - m_delay;}
+
+	float getJitter(){return m_jitter;}
+	float getDelay(){return m_delay;}
+
+	bool m_synced;
+	double m_serverTimeOffset; // server time - local time
+	double m_lastServerTime;
+	double m_lastTransit;
+	float m_snapshotInterval;
+	float m_jitter;
+	float m_delay;
+};
+
+// Timestamped snapshots of one remote entity. Gameplay code adds snapshots as ghost updates arrive
+// and samples it every frame at the render time of the connection (GhostManager::getInterpolationTime()).
+// Values are interpolated linearly; past the newest snapshot they are extrapolated for at most
+// PE_INTERPOLATION_MAX_EXTRAPOLATION seconds and then held.
+struct InterpolationBuffer
+{
+	InterpolationBuffer();
+
+	void clear(){m_count = 0;}
+
+	void addSnapshot(double serverTime, const PrimitiveTypes::Float32 *pValues, int numValues);
+
+	/// returns false if there are no snapshots yet
+	bool sample(double renderTime, PrimitiveTypes::Float32 *out_values);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	struct Snapshot
+	{
+		double m_time;
+		int m_numValues;
+		PrimitiveTypes::Float32 m_values[PE_INTERPOLATION_MAX_VALUES];
+	};
+
+	// i = 0 is the newest
+	Snapshot &snapshot(int i){return m_snapshots[(m_newest - i + PE_INTERPOLATION_BUFFER_SIZE) % PE_INTERPOLATION_BUFFER_SIZE];}
+
+	Snapshot m_snapshots[PE_INTERPOLATION_BUFFER_SIZE];
+	int m_newest;
+	int m_count;
+};
+
+}; // namespace PE
+#endif
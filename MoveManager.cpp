@@ -0,0 +1,363 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "MoveManager.h"
+
+// Outer-Engine includes
+#include <math.h>
+
+// Inter-Engine includes
+
+#if !PE_NETWORKING_HEADLESS
+#include "../Lua/LuaEnvironment.h"
+#endif
+
+// additional lua includes needed
+extern "C"
+{
+#include "../../luasocket_dist/src/socket.h"
+#include "../../luasocket_dist/src/inet.h"
+};
+
+#include "../../../GlobalConfig/GlobalConfig.h"
+
+#include "PrimeEngine/Events/StandardEvents.h"
+
+#if !PE_NETWORKING_HEADLESS
+#include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
+
+#include "StreamManager.h"
+#include "GhostManager.h"
+// Sibling/Children includes
+#include "BitStream.h"
+
+using namespace PE::Events;
+
+namespace PE {
+namespace Components {
+
+PE_IMPLEMENT_CLASS1(MoveManager, Component);
+
+MoveManager::MoveManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself)
+: Component(context, arena, hMyself)
+, m_nextMoveSequence(1)
+, m_numMovesNotSent(0)
+, m_lastAcknowledgedMove(0)
+, m_pPredictionBuffer(NULL)
+, m_pMoveHandler(NULL)
+, m_pControlObject(NULL)
+, m_lastProcessedRemoteMove(0)
+, m_lastProcessedRemoteMoveSent(0)
+, m_numRemoteMovesLost(0)
+, m_remoteInterpolationDelay(0)
+{
+	m_pNetContext = &netContext;
+}
+
+MoveManager::~MoveManager()
+{
+
+}
+
+void MoveManager::initialize()
+{
+
+}
+
+void MoveManager::addDefaultComponents()
+{
+	Component::addDefaultComponents();
+}
+
+PrimitiveTypes::UInt32 MoveManager::QuantizeFloat(PrimitiveTypes::Float32 v, PrimitiveTypes::Float32 range, int numBits)
+{
+	int maxQ = (1 << (numBits - 1)) - 1;
+	int q = (int)(floorf(v / range * maxQ + 0.5f));
+	if (q > maxQ) q = maxQ;
+	if (q < -maxQ) q = -maxQ;
+	return (PrimitiveTypes::UInt32)(q + maxQ);
+}
+
+PrimitiveTypes::Float32 MoveManager::DequantizeFloat(PrimitiveTypes::UInt32 q, PrimitiveTypes::Float32 range, int numBits)
+{
+	int maxQ = (1 << (numBits - 1)) - 1;
+	return (PrimitiveTypes::Float32)((int)(q) - maxQ) / maxQ * range;
+}
+
+void MoveManager::QuantizeMove(NetMove &move)
+{
+	move.m_x = DequantizeFloat(QuantizeFloat(move.m_x, 1.0f, PE_MOVE_AXIS_BITS), 1.0f, PE_MOVE_AXIS_BITS);
+	move.m_y = DequantizeFloat(QuantizeFloat(move.m_y, 1.0f, PE_MOVE_AXIS_BITS), 1.0f, PE_MOVE_AXIS_BITS);
+	move.m_z = DequantizeFloat(QuantizeFloat(move.m_z, 1.0f, PE_MOVE_AXIS_BITS), 1.0f, PE_MOVE_AXIS_BITS);
+	move.m_yaw = DequantizeFloat(QuantizeFloat(move.m_yaw, PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS), PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS);
+	move.m_pitch = DequantizeFloat(QuantizeFloat(move.m_pitch, PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS), PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS);
+	move.m_roll = DequantizeFloat(QuantizeFloat(move.m_roll, PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS), PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS);
+	move.m_triggers &= (1u << PE_MOVE_TRIGGER_BITS) - 1;
+}
+
+void MoveManager::addMove(NetMove &move)
+{
+	QuantizeMove(move);
+	move.m_sequence = m_nextMoveSequence++;
+
+	if (m_moves.size() >= PE_MOVE_HISTORY)
+	{
+		// server is not processing our moves (or its acknowledgments don't arrive). oldest move is lost
+		if (m_numMovesNotSent >= (int)(m_moves.size()))
+			--m_numMovesNotSent; // it was never sent
+		m_moves.pop_front();
+	}
+
+	m_moves.push_back(move);
+	++m_numMovesNotSent;
+	assert(m_numMovesNotSent <= (int)(m_moves.size()));
+
+	if (m_pPredictionBuffer)
+		m_pPredictionBuffer->predictMove(move);
+}
+
+int MoveManager::haveMovesToSend()
+{
+	return m_numMovesNotSent + (m_lastProcessedRemoteMove != m_lastProcessedRemoteMoveSent ? 1 : 0);
+}
+
+int MoveManager::fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore)
+{
+	out_usefulDataSent = false;
+	out_wantToSendMore = false;
+
+	int size = 0;
+
+	// our interpolation delay, server needs it to rewind to what we see (lag compensation)
+	float delayMs = m_pNetContext->getGhostManager()->getSnapshotClock().getDelay() * 1000.0f;
+	size += StreamManager::WriteInt16((PrimitiveTypes::Int16)(delayMs), &pDataStream[size]);
+
+	// acknowledgment of moves we received. is sent with every packet, so it doesn't need to be guaranteed
+	size += StreamManager::WriteInt32(m_lastProcessedRemoteMove, &pDataStream[size]);
+
+	// state of control object after that move, size 0 = no state
+	int stateSizeOffset = size;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]);
+
+	if (m_lastProcessedRemoteMove != m_lastProcessedRemoteMoveSent)
+	{
+		if (!m_pControlObject)
+		{
+			m_lastProcessedRemoteMoveSent = m_lastProcessedRemoteMove;
+			out_usefulDataSent = true;
+		}
+		else if (packetSizeAllocated - size - (int)(sizeof(PrimitiveTypes::Int32)) >= PE_PREDICTION_MAX_STATE_SIZE)
+		{
+			int stateSize = m_pControlObject->predict_packState(&pDataStream[size]);
+			assert(stateSize <= PE_PREDICTION_MAX_STATE_SIZE);
+			StreamManager::WriteInt32(stateSize, &pDataStream[stateSizeOffset]);
+			size += stateSize;
+
+			m_lastProcessedRemoteMoveSent = m_lastProcessedRemoteMove;
+			out_usefulDataSent = true;
+		}
+		// else no space left, state goes with next packet
+	}
+
+	int numMovesSizeOffset = size;
+	size += StreamManager::WriteInt32(0, &pDataStream[size]); // number of moves, written at the end
+
+	// first sequence + bit stream size
+	int recordsHeaderSize = sizeof(PrimitiveTypes::Int32) + sizeof(PrimitiveTypes::Int16);
+	int bitsAvailable = (packetSizeAllocated - size - recordsHeaderSize) * 8;
+
+	// every move that was never sent, plus up to PE_MOVE_REDUNDANCY sent ones before them in case those packets were lost
+	int numMovesWanted = m_numMovesNotSent + PE_MOVE_REDUNDANCY;
+	if (numMovesWanted > (int)(m_moves.size()))
+		numMovesWanted = (int)(m_moves.size());
+
+	int numMovesFit = bitsAvailable > 0 ? bitsAvailable / s_maxMoveBits : 0;
+
+	int numMoves = numMovesWanted;
+	int iFirst = (int)(m_moves.size()) - numMoves; // oldest of them first
+	int numNotSentLeft = 0;
+	if (numMovesFit < numMovesWanted)
+	{
+		numMoves = numMovesFit;
+		if (numMovesFit >= m_numMovesNotSent)
+			iFirst = (int)(m_moves.size()) - numMoves; // all unsent moves and fewer redundant ones
+		else
+		{
+			// not even the unsent moves fit. oldest go now, rest in next packet
+			iFirst = (int)(m_moves.size()) - m_numMovesNotSent;
+			numNotSentLeft = m_numMovesNotSent - numMoves;
+		}
+	}
+
+	if (numMoves == 0)
+	{
+		// moves that were never sent have to go in the next packet
+		out_wantToSendMore = m_numMovesNotSent > 0;
+		return size;
+	}
+
+	size += StreamManager::WriteInt32(m_moves[iFirst].m_sequence, &pDataStream[size]);
+	int bitStreamSizeOffset = size;
+	size += sizeof(PrimitiveTypes::Int16);
+
+	BitWriter writer(&pDataStream[size], bitsAvailable / 8);
+	for (int i = iFirst; i < iFirst + numMoves; ++i)
+	{
+		const NetMove &move = m_moves[i];
+
+		// held input repeats a lot, costs a bit. first record can't refer to previous one, receiver might not have it
+		if (i > iFirst && move.sameInput(m_moves[i - 1]))
+		{
+			writer.writeBool(true);
+			continue;
+		}
+
+		writer.writeBool(false);
+		writer.writeBits(QuantizeFloat(move.m_x, 1.0f, PE_MOVE_AXIS_BITS), PE_MOVE_AXIS_BITS);
+		writer.writeBits(QuantizeFloat(move.m_y, 1.0f, PE_MOVE_AXIS_BITS), PE_MOVE_AXIS_BITS);
+		writer.writeBits(QuantizeFloat(move.m_z, 1.0f, PE_MOVE_AXIS_BITS), PE_MOVE_AXIS_BITS);
+		writer.writeBits(QuantizeFloat(move.m_yaw, PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS), PE_MOVE_ROTATION_BITS);
+		writer.writeBits(QuantizeFloat(move.m_pitch, PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS), PE_MOVE_ROTATION_BITS);
+		writer.writeBits(QuantizeFloat(move.m_roll, PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS), PE_MOVE_ROTATION_BITS);
+		writer.writeBits(move.m_triggers, PE_MOVE_TRIGGER_BITS);
+	}
+
+	StreamManager::WriteInt16((PrimitiveTypes::Int16)(writer.bytesWritten()), &pDataStream[bitStreamSizeOffset]);
+	size += writer.bytesWritten();
+
+	StreamManager::WriteInt32(numMoves, &pDataStream[numMovesSizeOffset]);
+
+	out_usefulDataSent = true;
+
+	m_numMovesNotSent = numNotSentLeft;
+	out_wantToSendMore = numNotSentLeft > 0;
+
+	return size;
+}
+
+int MoveManager::receiveNextPacket(char *pDataStream, int dataSizeLeft)
+{
+	// sizes and counts come from the other side. anything that doesn't fit drops the packet
+	int read = 0;
+	if (dataSizeLeft < (int)(sizeof(PrimitiveTypes::Int16) + sizeof(PrimitiveTypes::Int32) * 3)) // delay, ack, state size, move count
+	{
+		PEINFO("PE: Warning: Move stream is cut off. Packet will be dropped\n");
+		return -1;
+	}
+
+	PrimitiveTypes::Int16 delayMs;
+	read += StreamManager::ReadInt16(&pDataStream[read], delayMs);
+	m_remoteInterpolationDelay = delayMs / 1000.0f;
+
+	// the other side tells us how far it got with our moves
+	PrimitiveTypes::Int32 lastProcessed;
+	read += StreamManager::ReadInt32(&pDataStream[read], lastProcessed);
+	if (lastProcessed > m_lastAcknowledgedMove)
+	{
+		m_lastAcknowledgedMove = lastProcessed;
+		while (m_moves.size() && m_moves.front().m_sequence <= m_lastAcknowledgedMove)
+			m_moves.pop_front();
+		if (m_numMovesNotSent > (int)(m_moves.size()))
+			m_numMovesNotSent = (int)(m_moves.size());
+	}
+
+	PrimitiveTypes::Int32 stateSize;
+	read += StreamManager::ReadInt32(&pDataStream[read], stateSize);
+	if (stateSize < 0 || stateSize > PE_PREDICTION_MAX_STATE_SIZE || stateSize > dataSizeLeft - read - (int)(sizeof(PrimitiveTypes::Int32)))
+	{
+		PEINFO("PE: Warning: Received invalid control object state size %d. Packet will be dropped\n", stateSize);
+		return -1;
+	}
+	if (stateSize)
+	{
+		if (m_pPredictionBuffer)
+			m_pPredictionBuffer->reconcile(lastProcessed, &pDataStream[read], stateSize);
+		read += stateSize;
+	}
+
+	PrimitiveTypes::Int32 numMoves;
+	read += StreamManager::ReadInt32(&pDataStream[read], numMoves);
+	if (numMoves == 0)
+		return read;
+
+	if (numMoves < 0 || numMoves > PE_MOVE_HISTORY || dataSizeLeft - read < (int)(sizeof(PrimitiveTypes::Int32) + sizeof(PrimitiveTypes::Int16)))
+	{
+		PEINFO("PE: Warning: Received invalid number of moves %d. Packet will be dropped\n", numMoves);
+		return -1;
+	}
+
+	PrimitiveTypes::Int32 firstSequence;
+	read += StreamManager::ReadInt32(&pDataStream[read], firstSequence);
+
+	PrimitiveTypes::Int16 bitStreamSize;
+	read += StreamManager::ReadInt16(&pDataStream[read], bitStreamSize);
+
+	// every record takes at least one bit
+	if (bitStreamSize < 0 || bitStreamSize > dataSizeLeft - read || numMoves > bitStreamSize * 8)
+	{
+		PEINFO("PE: Warning: Received invalid move bit stream size %d. Packet will be dropped\n", (int)(bitStreamSize));
+		return -1;
+	}
+
+	BitReader reader(&pDataStream[read], bitStreamSize);
+	NetMove move;
+	for (int i = 0; i < numMoves; ++i)
+	{
+		if (reader.bitsLeft() < 1)
+		{
+			PEINFO("PE: Warning: Move bit stream is cut off. Packet will be dropped\n");
+			return -1;
+		}
+
+		if (!reader.readBool())
+		{
+			if (reader.bitsLeft() < s_maxMoveBits - 1)
+			{
+				PEINFO("PE: Warning: Move bit stream is cut off. Packet will be dropped\n");
+				return -1;
+			}
+
+			move.m_x = DequantizeFloat(reader.readBits(PE_MOVE_AXIS_BITS), 1.0f, PE_MOVE_AXIS_BITS);
+			move.m_y = DequantizeFloat(reader.readBits(PE_MOVE_AXIS_BITS), 1.0f, PE_MOVE_AXIS_BITS);
+			move.m_z = DequantizeFloat(reader.readBits(PE_MOVE_AXIS_BITS), 1.0f, PE_MOVE_AXIS_BITS);
+			move.m_yaw = DequantizeFloat(reader.readBits(PE_MOVE_ROTATION_BITS), PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS);
+			move.m_pitch = DequantizeFloat(reader.readBits(PE_MOVE_ROTATION_BITS), PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS);
+			move.m_roll = DequantizeFloat(reader.readBits(PE_MOVE_ROTATION_BITS), PE_MOVE_MAX_ROTATION, PE_MOVE_ROTATION_BITS);
+			move.m_triggers = reader.readBits(PE_MOVE_TRIGGER_BITS);
+		}
+		// else same input as previous record, move already holds it
+		move.m_sequence = firstSequence + i;
+
+		if (move.m_sequence <= m_lastProcessedRemoteMove)
+			continue; // redundant copy of a move we already applied
+
+		if (m_lastProcessedRemoteMove && move.m_sequence > m_lastProcessedRemoteMove + 1)
+		{
+			m_numRemoteMovesLost += move.m_sequence - m_lastProcessedRemoteMove - 1;
+			PEINFO("MoveManager: lost %d moves\n", move.m_sequence - m_lastProcessedRemoteMove - 1);
+		}
+
+		if (m_pMoveHandler)
+			m_pMoveHandler->applyMove(m_pNetContext->getClientId(), move);
+
+		m_lastProcessedRemoteMove = move.m_sequence;
+	}
+
+	read += bitStreamSize;
+	return read;
+}
+
+void MoveManager::debugRender(int &threadOwnershipMask, float xoffset/* = 0*/, float yoffset/* = 0*/)
+{
+#if !PE_NETWORKING_HEADLESS
+	sprintf(PEString::s_buf, "Move Manager: %d pending moves, last processed remote %d, %d lost", (int)(m_moves.size()), m_lastProcessedRemoteMove, m_numRemoteMovesLost);
+	DebugRenderer::Instance()->createTextMesh(
+		PEString::s_buf, true, false, false, false, 0,
+		Vector3(xoffset, yoffset, 0), 1.0f, threadOwnershipMask);
+#endif
+}
+
+}; // namespace Components
+}; // namespace PE
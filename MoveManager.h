@@ -0,0 +1,118 @@
+#ifndef __PrimeEngineMoveManager_H__
+#define __PrimeEngineMoveManager_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <deque>
+
+// Inter-Engine includes
+
+#include "../Events/Component.h"
+
+extern "C"
+{
+#include "../../luasocket_dist/src/socket.h"
+};
+
+#include "PrimeEngine/Networking/NetworkContext.h"
+#include "PrimeEngine/Utils/Networkable.h"
+
+// Sibling/Children includes
+#include "Packet.h"
+#include "MoveTransmissionData.h"
+#include "PredictionBuffer.h"
+#include "NetworkingConfig.h"
+
+namespace PE {
+namespace Components {
+
+// Transmits client input over one connection (Tribes move manager)
+// Moves are not guaranteed and are never resent. Instead every packet carries all moves not sent yet
+// plus up to PE_MOVE_REDUNDANCY earlier ones the other side has not processed yet, bit packed; a move that repeats
+// the previous one costs one bit. Receiver applies every move exactly once, in sequence order,
+// and sends back sequence of the last move it processed so that sender can forget older moves.
+// If server has a control object set, its state after that move goes along, so that client can
+// reconcile its prediction (see PredictionBuffer).
+struct MoveManager : public Component
+{
+	PE_DECLARE_CLASS(MoveManager);
+
+	// Constructor -------------------------------------------------------------
+	MoveManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself);
+
+	virtual ~MoveManager();
+
+	// Methods -----------------------------------------------------------------
+	virtual void initialize();
+
+	/// called by gameplay code on client once per input frame. move is quantized in place, so that
+	/// client simulates exactly what server will see, and gets its sequence number assigned
+	void addMove(NetMove &move);
+
+	/// called by gameplay code on server to receive moves of this connection's client
+	void setMoveHandler(NetMoveHandler *pMoveHandler){m_pMoveHandler = pMoveHandler;}
+
+	/// called by gameplay code on server. state of the object is sent to client with every move acknowledgment
+	void setControlObject(NetPredictable *pControlObject){m_pControlObject = pControlObject;}
+
+	/// called by gameplay code on client to predict the controlled object. buffer is owned by caller
+	void setPredictionBuffer(PredictionBuffer *pPredictionBuffer){m_pPredictionBuffer = pPredictionBuffer;}
+
+	/// sequence of the last of our moves that the other side has processed
+	PrimitiveTypes::Int32 getLastAcknowledgedMove(){return m_lastAcknowledgedMove;}
+
+	/// sequence of the last move of the other side that we have processed
+	PrimitiveTypes::Int32 getLastProcessedRemoteMove(){return m_lastProcessedRemoteMove;}
+
+	/// how far behind the server the other side renders remote entities (seconds). is reported with every packet
+	float getRemoteInterpolationDelay(){return m_remoteInterpolationDelay;}
+
+	/// called by stream manager to see whether there are moves or move acknowledgment to send
+	int haveMovesToSend();
+
+	/// called by StreamManager to put latest moves in packet
+	int fillInNextPacket(char *pDataStream, TransmissionRecord *pRecord, int packetSizeAllocated, bool &out_usefulDataSent, bool &out_wantToSendMore);
+
+	/// dataSizeLeft is what is left of the packet. returns -1 if moves are malformed (rest of packet is dropped)
+	int receiveNextPacket(char *pDataStream, int dataSizeLeft);
+
+	void debugRender(int &threadOwnershipMask, float xoffset = 0, float yoffset = 0);
+
+	// quantization
+	static PrimitiveTypes::UInt32 QuantizeFloat(PrimitiveTypes::Float32 v, PrimitiveTypes::Float32 range, int numBits);
+	static PrimitiveTypes::Float32 DequantizeFloat(PrimitiveTypes::UInt32 q, PrimitiveTypes::Float32 range, int numBits);
+	static void QuantizeMove(NetMove &move);
+
+	// Component ------------------------------------------------------------
+	virtual void addDefaultComponents();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	// max size of one bit packed move record
+	static const int s_maxMoveBits = 1 + 3 * PE_MOVE_AXIS_BITS + 3 * PE_MOVE_ROTATION_BITS + PE_MOVE_TRIGGER_BITS;
+
+	// sending side
+	std::deque<NetMove> m_moves; // moves the other side didn't process yet, oldest first
+	PrimitiveTypes::Int32 m_nextMoveSequence;
+	int m_numMovesNotSent; // moves added after the last packet was sent
+	PrimitiveTypes::Int32 m_lastAcknowledgedMove;
+	PredictionBuffer *m_pPredictionBuffer;
+
+	// receiving side
+	NetMoveHandler *m_pMoveHandler;
+	NetPredictable *m_pControlObject;
+	PrimitiveTypes::Int32 m_lastProcessedRemoteMove; // 0 = none
+	PrimitiveTypes::Int32 m_lastProcessedRemoteMoveSent; // what we last told the other side
+	int m_numRemoteMovesLost; // moves that were lost in more packets in a row than redundancy covers
+	float m_remoteInterpolationDelay;
+
+	PE::NetworkContext *m_pNetContext;
+};
+}; // namespace Components
+}; // namespace PE
+#endif
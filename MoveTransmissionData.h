@@ -0,0 +1,81 @@
+#ifndef __PrimeEngineMoveTransmissionData_H__
+#define __PrimeEngineMoveTransmissionData_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <string.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+// how many already sent moves every client packet carries again. a move is lost only if this many packets in a row are lost
+#define PE_MOVE_REDUNDANCY 4
+
+// how many moves client keeps while waiting for server to process them
+#define PE_MOVE_HISTORY 32
+
+// quantization of move records
+#define PE_MOVE_AXIS_BITS 6 // movement axes in [-1, 1]
+#define PE_MOVE_ROTATION_BITS 16 // rotation deltas in [-PE_MOVE_MAX_ROTATION, PE_MOVE_MAX_ROTATION]
+#define PE_MOVE_TRIGGER_BITS 8 // buttons
+#define PE_MOVE_MAX_ROTATION 3.14159265f
+
+// one frame of client input. moves are numbered by sequence and applied by server exactly once in order
+struct NetMove
+{
+	NetMove()
+		: m_sequence(0)
+		, m_x(0), m_y(0), m_z(0)
+		, m_yaw(0), m_pitch(0), m_roll(0)
+		, m_triggers(0)
+	{}
+
+	PrimitiveTypes::Int32 m_sequence; // assigned by MoveManager::addMove()
+	PrimitiveTypes::Float32 m_x, m_y, m_z; // movement axes
+	PrimitiveTypes::Float32 m_yaw, m_pitch, m_roll; // rotation deltas in radians
+	PrimitiveTypes::UInt32 m_triggers; // bit per button
+
+	bool sameInput(const NetMove &other) const
+	{
+		return m_x == other.m_x && m_y == other.m_y && m_z == other.m_z
+			&& m_yaw == other.m_yaw && m_pitch == other.m_pitch && m_roll == other.m_roll
+			&& m_triggers == other.m_triggers;
+	}
+};
+
+// max size of packed state of a predicted (controlled) object
+#define PE_PREDICTION_MAX_STATE_SIZE 256
+
+// implemented by the object client controls (e.g. client's car). is simulated by moves on both sides:
+// on server authoritatively, on client ahead of server (see PredictionBuffer)
+struct NetPredictable
+{
+	// simulate one move
+	virtual void predict_applyMove(const NetMove &move) = 0;
+
+	// write/read complete simulation state, return number of bytes written/read
+	virtual int predict_packState(char *pDataStream) = 0;
+	virtual int predict_unpackState(char *pDataStream) = 0;
+
+	// decides whether client mispredicted. override to allow for float tolerance
+	virtual bool predict_statesMatch(const char *pPredicted, const char *pAuthoritative, int size)
+	{
+		return memcmp(pPredicted, pAuthoritative, size) == 0;
+	}
+};
+
+// implemented by gameplay code on server to apply moves of a client to the object the client controls
+// is registered per connection with MoveManager::setMoveHandler()
+struct NetMoveHandler
+{
+	virtual void applyMove(int clientId, const NetMove &move) = 0;
+};
+
+}; // namespace PE
+#endif
@@ -0,0 +1,68 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "NetStringTable.h"
+
+// Outer-Engine includes
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+#include "Packet.h"
+
+namespace PE {
+
+NetStringTable::NetStringTable()
+: m_nextLocalId(1) // 0 = not interned
+, m_pPackingEvent(NULL)
+{
+	m_localAcknowledged.resize(PE_NET_STRING_TABLE_SIZE, 0);
+	m_remoteStrings.resize(PE_NET_STRING_TABLE_SIZE);
+	m_remoteDefined.resize(PE_NET_STRING_TABLE_SIZE, 0);
+}
+
+PrimitiveTypes::Int16 NetStringTable::intern(const char *str)
+{
+	std::unordered_map<std::string, PrimitiveTypes::Int16>::iterator i = m_localIds.find(str);
+	if (i != m_localIds.end())
+		return i->second;
+
+	if (m_nextLocalId >= PE_NET_STRING_TABLE_SIZE)
+		return 0;
+
+	PrimitiveTypes::Int16 id = m_nextLocalId++;
+	m_localIds[str] = id;
+	return id;
+}
+
+void NetStringTable::noteDefinitionSent(PrimitiveTypes::Int16 id)
+{
+	if (!m_pPackingEvent || m_pPackingEvent->m_numStringDefinitions >= PE_MAX_EVENT_STRING_DEFINITIONS)
+		return;
+
+	m_pPackingEvent->m_stringDefinitions[m_pPackingEvent->m_numStringDefinitions++] = id;
+}
+
+bool NetStringTable::define(int id, const char *str)
+{
+	if (id <= 0 || id >= PE_NET_STRING_TABLE_SIZE)
+		return false;
+
+	if (m_remoteDefined[id])
+		return true; // definitions are repeated until sender learns we have them
+
+	m_remoteStrings[id] = str;
+	m_remoteDefined[id] = 1;
+	return true;
+}
+
+const char *NetStringTable::resolve(PrimitiveTypes::Int16 id)
+{
+	if (id <= 0 || id >= PE_NET_STRING_TABLE_SIZE || !m_remoteDefined[id])
+		return NULL;
+
+	return m_remoteStrings[id].c_str();
+}
+
+}; // namespace PE
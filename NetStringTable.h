@@ -0,0 +1,70 @@
+#ifndef __PrimeEngineNetStringTable_H__
+#define __PrimeEngineNetStringTable_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+// max number of strings interned per connection per direction. strings past this are sent in full every time
+#define PE_NET_STRING_TABLE_SIZE 4096
+
+// max number of string definitions tracked per event. definitions past this are not acknowledged and are sent again next time
+#define PE_MAX_EVENT_STRING_DEFINITIONS 4
+
+namespace PE {
+
+struct EventTransmissionData;
+
+// Interned strings of one connection (names, asset paths, chat channels...).
+// Sender assigns every new string a small id. The string goes along with its id ("definition") every
+// time it is written until a packet carrying the definition is acknowledged; from then on only the id is sent.
+// Receiver remembers definitions and resolves ids. Each side has its own ids for the strings it sends.
+// See StreamManager::WriteNetString()/ReadNetString().
+struct NetStringTable
+{
+	NetStringTable();
+
+	// Sending -----------------------------------------------------------------
+	/// returns id of string, 0 if table is full
+	PrimitiveTypes::Int16 intern(const char *str);
+
+	bool isAcknowledged(PrimitiveTypes::Int16 id){return m_localAcknowledged[id] != 0;}
+
+	/// called when event that carried definition was delivered
+	void acknowledge(PrimitiveTypes::Int16 id){m_localAcknowledged[id] = 1;}
+
+	/// remembers definition in event being packed, so that it can be acknowledged on delivery
+	void noteDefinitionSent(PrimitiveTypes::Int16 id);
+
+	// Receiving ---------------------------------------------------------------
+	/// id comes from the other side. returns false if it is out of range
+	bool define(int id, const char *str);
+
+	/// NULL if id was never defined
+	const char *resolve(PrimitiveTypes::Int16 id);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	std::unordered_map<std::string, PrimitiveTypes::Int16> m_localIds;
+	std::vector<char> m_localAcknowledged; // indexed by id
+	PrimitiveTypes::Int16 m_nextLocalId;
+
+	std::vector<std::string> m_remoteStrings; // indexed by id
+	std::vector<char> m_remoteDefined;
+
+	EventTransmissionData *m_pPackingEvent; // event being packed, if any
+};
+
+}; // namespace PE
+#endif
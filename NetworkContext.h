@@ -11,6 +11,9 @@ namespace Components{
 	struct ConnectionManager;
 	struct EventManager;
 	struct StreamManager;
+	struct GhostManager;
+	struct MoveManager;
+	struct DatablockManager;
 };
 struct NetworkContext
 {
@@ -18,16 +21,25 @@ struct NetworkContext
 		: m_pConnectionManager(NULL)
 		, m_pEventManager(NULL)
 		, m_pStreamManager(NULL)
+		, m_pGhostManager(NULL)
+		, m_pMoveManager(NULL)
+		, m_pDatablockManager(NULL)
 		, m_clientId(-1)
 	{}
 	Components::ConnectionManager *getConnectionManager(){return m_pConnectionManager;}
 	Components::EventManager *getEventManager(){return m_pEventManager;}
 	Components::StreamManager *getStreamManager(){return m_pStreamManager;}
+	Components::GhostManager *getGhostManager(){return m_pGhostManager;}
+	Components::MoveManager *getMoveManager(){return m_pMoveManager;}
+	Components::DatablockManager *getDatablockManager(){return m_pDatablockManager;}
 	int getClientId(){return m_clientId;}
 	
 	Components::ConnectionManager *m_pConnectionManager;
 	Components::EventManager *m_pEventManager;
 	Components::StreamManager *m_pStreamManager;
+	Components::GhostManager *m_pGhostManager;
+	Components::MoveManager *m_pMoveManager;
+	Components::DatablockManager *m_pDatablockManager;
 
 	int m_clientId; // id of client in the list of contexts on server. on client is invalid since have only one connection
 };
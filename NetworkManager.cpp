@@ -8,10 +8,15 @@
 
 
 // Inter-Engine includes
+#if !PE_NETWORKING_HEADLESS
 #include "../Lua/LuaEnvironment.h"
+#endif
 
 // Sibling/Children includes
 #include "ConnectionManager.h"
+#include "GhostManager.h"
+#include "MoveManager.h"
+#include "DatablockManager.h"
 
 // additional lua includes needed
 extern "C"
@@ -34,6 +39,12 @@ NetworkManager::NetworkManager(PE::GameContext &context, PE::MemoryArena arena,
 : Component(context, arena, hMyself)
 , Networkable(context, this) // don't register networkable trhough contructor since NetworkManager is nto constructed yet
 {
+	m_timeBase = timeout_gettime();
+
+	m_tickRate = PE_NETWORK_DEFAULT_TICK_RATE;
+	m_tickNumber = 0;
+	m_tickTime = 0;
+	m_nextTickTime = 0; // first tick runs on first update
 
 	// can register networkable now here:
 	m_networkId = s_NetworkId_NetworkManager;
@@ -61,36 +72,201 @@ void NetworkManager::initNetwork()
 
 void NetworkManager::registerNetworkableObject(Networkable *pNetworkable)
 {
-	assert(pNetworkable->m_networkId);
+	if (!pNetworkable->m_networkId)
+	{
+		// allocate new id. reuse freed slot if we have one
+		PrimitiveTypes::UInt32 index = 0;
+		while (m_freeNetworkableSlots.size())
+		{
+			PrimitiveTypes::UInt32 freeIndex = m_freeNetworkableSlots.back();
+			m_freeNetworkableSlots.pop_back();
+			if (!m_networkableSlots[freeIndex].m_pNetworkable)
+			{
+				index = freeIndex;
+				break;
+			}
+		}
+
+		if (!index)
+		{
+			if (m_networkableSlots.size() < PE_NETWORK_ID_FIRST_DYNAMIC_INDEX)
+			{
+				NetworkableSlot emptySlot = {NULL, NULL, NULL, 0};
+				m_networkableSlots.resize(PE_NETWORK_ID_FIRST_DYNAMIC_INDEX, emptySlot);
+			}
+			index = (PrimitiveTypes::UInt32)(m_networkableSlots.size());
+			PEASSERT(index < (1 << PE_NETWORK_ID_INDEX_BITS), "Ran out of network id slots");
+
+			NetworkableSlot newSlot = {NULL, NULL, NULL, 0};
+			m_networkableSlots.push_back(newSlot);
+		}
 
-	NetworkableMap::iterator i = m_networkables.find(pNetworkable->m_networkId);
-	assert(i == m_networkables.end());
+		pNetworkable->m_networkId = MakeNetworkId(index, m_networkableSlots[index].m_generation);
+	}
+
+	PrimitiveTypes::UInt32 index = NetworkIdIndex(pNetworkable->m_networkId);
+	PrimitiveTypes::UInt32 generation = NetworkIdGeneration(pNetworkable->m_networkId);
+	assert(index);
+
+	if (index >= m_networkableSlots.size())
+	{
+		// explicitly claiming slot past the end (id was given to us), the slots in between become free dynamic slots
+		PrimitiveTypes::UInt32 oldSize = (PrimitiveTypes::UInt32)(m_networkableSlots.size());
+		NetworkableSlot emptySlot = {NULL, NULL, NULL, 0};
+		m_networkableSlots.resize(index + 1, emptySlot);
+		for (PrimitiveTypes::UInt32 i = oldSize; i < index; ++i)
+		{
+			if (i >= PE_NETWORK_ID_FIRST_DYNAMIC_INDEX)
+				m_freeNetworkableSlots.push_back(i);
+		}
+	}
 
-	m_networkables[pNetworkable->m_networkId] = pNetworkable;
+	NetworkableSlot &slot = m_networkableSlots[index];
+	assert(!slot.m_pNetworkable);
 
+	slot.m_pNetworkable = pNetworkable;
+	slot.m_pBatchHandler = NULL;
+	slot.m_pGhostable = NULL;
+	slot.m_generation = generation;
+}
+
+void NetworkManager::unregisterNetworkableObject(Networkable *pNetworkable)
+{
+	PrimitiveTypes::UInt32 index = NetworkIdIndex(pNetworkable->m_networkId);
+	if (index >= m_networkableSlots.size())
+		return;
+
+	NetworkableSlot &slot = m_networkableSlots[index];
+	if (slot.m_pNetworkable != pNetworkable)
+		return; // already unregistered
+
+	slot.m_pNetworkable = NULL;
+	slot.m_pBatchHandler = NULL;
+	slot.m_pGhostable = NULL;
+	slot.m_generation = (slot.m_generation + 1) & ((1 << PE_NETWORK_ID_GENERATION_BITS) - 1);
+
+	if (index >= PE_NETWORK_ID_FIRST_DYNAMIC_INDEX)
+		m_freeNetworkableSlots.push_back(index);
 }
 
 Networkable *NetworkManager::getNetworkableObject(Networkable::NetworkId networkId)
 {
-	assert(networkId);
+	PrimitiveTypes::UInt32 index = NetworkIdIndex(networkId);
+	if (!index || index >= m_networkableSlots.size())
+		return NULL;
+
+	NetworkableSlot &slot = m_networkableSlots[index];
+	if (slot.m_generation != NetworkIdGeneration(networkId))
+		return NULL; // stale id, object this id was referring to is gone
+
+	return slot.m_pNetworkable;
+}
+
+void NetworkManager::setNetworkableBatchHandler(Networkable::NetworkId networkId, NetworkEventBatchHandler *pBatchHandler)
+{
+	assert(getNetworkableObject(networkId));
+
+	m_networkableSlots[NetworkIdIndex(networkId)].m_pBatchHandler = pBatchHandler;
+}
+
+NetworkEventBatchHandler *NetworkManager::getNetworkableBatchHandler(Networkable::NetworkId networkId)
+{
+	if (!getNetworkableObject(networkId))
+		return NULL;
+
+	return m_networkableSlots[NetworkIdIndex(networkId)].m_pBatchHandler;
+}
+
+void NetworkManager::setNetworkableGhostable(Networkable::NetworkId networkId, NetGhostable *pGhostable)
+{
+	assert(getNetworkableObject(networkId));
+
+	m_networkableSlots[NetworkIdIndex(networkId)].m_pGhostable = pGhostable;
+}
 
-	NetworkableMap::iterator i = m_networkables.find(networkId);
-	assert(i != m_networkables.end());
-	if (i != m_networkables.end())
-		return i->second;
+NetGhostable *NetworkManager::getNetworkableGhostable(Networkable::NetworkId networkId)
+{
+	if (!getNetworkableObject(networkId))
+		return NULL;
 
-	return NULL;
+	return m_networkableSlots[NetworkIdIndex(networkId)].m_pGhostable;
 }
 
 void NetworkManager::createNetworkConnectionContext(t_socket sock, PE::NetworkContext *pNetContext)
 {
+	// managers that are the same on server and client
+	{
+		pNetContext->m_pGhostManager = new (m_arena) GhostManager(*m_pContext, m_arena, *pNetContext, Handle());
+		pNetContext->getGhostManager()->addDefaultComponents();
+
+		pNetContext->m_pMoveManager = new (m_arena) MoveManager(*m_pContext, m_arena, *pNetContext, Handle());
+		pNetContext->getMoveManager()->addDefaultComponents();
+
+		pNetContext->m_pDatablockManager = new (m_arena) DatablockManager(*m_pContext, m_arena, *pNetContext, Handle());
+		pNetContext->getDatablockManager()->addDefaultComponents();
+	}
+}
+
+void NetworkManager::destroyNetworkConnectionContext(PE::NetworkContext *pNetContext)
+{
+	delete pNetContext->m_pGhostManager;
+	delete pNetContext->m_pMoveManager;
+	delete pNetContext->m_pDatablockManager;
+
+	*pNetContext = NetworkContext();
 }
 
 
+void NetworkManager::setTickRate(int ticksPerSecond)
+{
+	if (ticksPerSecond < 1)
+		ticksPerSecond = 1;
+	if (ticksPerSecond > PE_NETWORK_MAX_TICK_RATE)
+		ticksPerSecond = PE_NETWORK_MAX_TICK_RATE;
+	m_tickRate = ticksPerSecond;
+	m_nextTickTime = m_tickTime + getTickInterval();
+}
+
+float NetworkManager::getTickAlpha()
+{
+	float alpha = (float)((getNetworkTime() - m_tickTime) / getTickInterval());
+	if (alpha < 0)
+		alpha = 0;
+	if (alpha > 1.0f)
+		alpha = 1.0f;
+	return alpha;
+}
+
 void NetworkManager::do_UPDATE(Events::Event *pEvt)
 {
-	
+	runTicks();
 }
+
+void NetworkManager::runTicks()
+{
+	double now = getNetworkTime();
+	double interval = getTickInterval();
+
+	int ticksRun = 0;
+	while (m_nextTickTime <= now)
+	{
+		if (ticksRun >= PE_NETWORK_MAX_TICKS_PER_FRAME)
+		{
+			// long hitch: catching up fully would make next frame even longer. skip to latest tick boundary
+			int missed = (int)((now - m_nextTickTime) / interval) + 1;
+			m_nextTickTime += missed * interval;
+			break;
+		}
+
+		m_tickTime = m_nextTickTime;
+		m_nextTickTime += interval;
+		++m_tickNumber;
+		++ticksRun;
+
+		networkTick();
+	}
+}
+#if !PE_NETWORKING_HEADLESS
 //////////////////////////////////////////////////////////////////////////
 // NetworkManager Lua Interface
 //////////////////////////////////////////////////////////////////////////
@@ -143,7 +319,7 @@ int NetworkManager::l_GetSkin(lua_State *luaVM)
 }
 */
 //////////////////////////////////////////////////////////////////////////
+#endif
 
-	
 }; // namespace Components
 }; // namespace PE
@@ -6,7 +6,7 @@
 
 // Outer-Engine includes
 #include <assert.h>
-#include <map>
+#include <vector>
 
 // Inter-Engine includes
 #include "PrimeEngine/Utils/Networkable.h"
@@ -16,12 +16,34 @@
 extern "C"
 {
 #include "../../luasocket_dist/src/socket.h"
+#include "../../luasocket_dist/src/timeout.h"
 };
 
 // Sibling/Children includes
 #include "NetworkContext.h"
+#include "NetworkingConfig.h"
+
+// network ids are (index, generation) pairs packed into 32 bits
+// index is the slot in the dense networkable array, generation is bumped every time the slot is freed
+// so that ids that refer to already unregistered objects can be detected
+#define PE_NETWORK_ID_INDEX_BITS 20
+#define PE_NETWORK_ID_GENERATION_BITS 11
+
+// slots below this index are reserved for well known ids (like s_NetworkId_NetworkManager)
+// these ids always have generation 0 and are never recycled through free list
+#define PE_NETWORK_ID_FIRST_DYNAMIC_INDEX 256
+
+// network tick: receive, replication and send run at fixed rate independent of frame rate
+#define PE_NETWORK_DEFAULT_TICK_RATE 30 // ticks per second
+#define PE_NETWORK_MAX_TICK_RATE 128
+// slow frame catches up with at most this many ticks, ticks missed beyond that are dropped
+#define PE_NETWORK_MAX_TICKS_PER_FRAME 4
 
 namespace PE {
+
+struct NetworkEventBatchHandler;
+struct NetGhostable;
+
 namespace Components {
 
 struct NetworkManager : public Component, public Networkable
@@ -40,14 +62,64 @@ struct NetworkManager : public Component, public Networkable
 	// Component ------------------------------------------------------------
 	virtual void addDefaultComponents();
 
+	// if networkable has no network id yet, a new (index, generation) id is allocated for it
+	// otherwise the exact slot of given id is claimed (well known ids, ids received from server)
 	void registerNetworkableObject(Networkable *pNetworkable);
 
+	// frees the slot for reuse. the slot generation is advanced so that any id still in flight becomes stale
+	void unregisterNetworkableObject(Networkable *pNetworkable);
+
+	// O(1) lookup. returns NULL if id is invalid or stale (object was unregistered)
 	Networkable *getNetworkableObject(Networkable::NetworkId networkId);
 
+	// optional bulk receiver of unguaranteed events targeting this networkable (see EventManager::setGroupedDispatch)
+	void setNetworkableBatchHandler(Networkable::NetworkId networkId, NetworkEventBatchHandler *pBatchHandler);
+	NetworkEventBatchHandler *getNetworkableBatchHandler(Networkable::NetworkId networkId);
+
+	// state replication interface of networkable, used by ghost manager to find the object on receiving side
+	void setNetworkableGhostable(Networkable::NetworkId networkId, NetGhostable *pGhostable);
+	NetGhostable *getNetworkableGhostable(Networkable::NetworkId networkId);
+
+	static Networkable::NetworkId MakeNetworkId(PrimitiveTypes::UInt32 index, PrimitiveTypes::UInt32 generation)
+	{
+		return (Networkable::NetworkId)((generation << PE_NETWORK_ID_INDEX_BITS) | index);
+	}
+	static PrimitiveTypes::UInt32 NetworkIdIndex(Networkable::NetworkId networkId)
+	{
+		return (PrimitiveTypes::UInt32)(networkId) & ((1 << PE_NETWORK_ID_INDEX_BITS) - 1);
+	}
+	static PrimitiveTypes::UInt32 NetworkIdGeneration(Networkable::NetworkId networkId)
+	{
+		return ((PrimitiveTypes::UInt32)(networkId) >> PE_NETWORK_ID_INDEX_BITS) & ((1 << PE_NETWORK_ID_GENERATION_BITS) - 1);
+	}
+
+
+	// seconds since network manager was created. all network timestamps (ghost updates, lag compensation history) use it
+	double getNetworkTime(){return timeout_gettime() - m_timeBase;}
+
+	// fixed rate network tick. do_UPDATE runs networkTick() once for every tick interval that passed since last frame (see runTicks())
+	void setTickRate(int ticksPerSecond);
+	int getTickRate(){return m_tickRate;}
+	double getTickInterval(){return 1.0 / m_tickRate;}
+	/// number of ticks run so far, 0 before first tick
+	PrimitiveTypes::UInt32 getTickNumber(){return m_tickNumber;}
+	/// network time of latest tick (its nominal time, ticks are exactly one interval apart)
+	double getTickTime(){return m_tickTime;}
+	/// how far current time is between latest tick and next one, 0..1. for interpolating state produced by ticks
+	float getTickAlpha();
+	/// runs networkTick() for every tick interval that passed. does nothing if next tick is not due yet, so it can be called
+	/// more than once per frame: components that run per tick call it themselves instead of relying on update order
+	void runTicks();
+
+	/// receive, replication and send stages of one tick
+	virtual void networkTick(){}
 
 	// is created per single connection
 	virtual void createNetworkConnectionContext(t_socket sock, PE::NetworkContext *pNetContext);
 
+	// frees managers of connection and resets context so that it can be reused
+	virtual void destroyNetworkConnectionContext(PE::NetworkContext *pNetContext);
+
 	// Individual events -------------------------------------------------------
 	PE_DECLARE_IMPLEMENT_EVENT_HANDLER_WRAPPER(do_UPDATE);
 	virtual void do_UPDATE(Events::Event *pEvt);
@@ -58,7 +130,9 @@ struct NetworkManager : public Component, public Networkable
 	// Skin Lua Interface
 	//////////////////////////////////////////////////////////////////////////
 	//
+#if !PE_NETWORKING_HEADLESS
 	static void SetLuaFunctions(PE::Components::LuaEnvironment *pLuaEnv, lua_State *luaVM);
+#endif
 	//
 	//static int l_GetSkin(lua_State *luaVM);
 	//
@@ -68,8 +142,25 @@ struct NetworkManager : public Component, public Networkable
 	// Member variables 
 	//////////////////////////////////////////////////////////////////////////
 	
-	typedef std::map<Networkable::NetworkId, Networkable *> NetworkableMap;
-	NetworkableMap m_networkables;
+	struct NetworkableSlot
+	{
+		Networkable *m_pNetworkable; // NULL if slot is free
+		NetworkEventBatchHandler *m_pBatchHandler;
+		NetGhostable *m_pGhostable;
+		PrimitiveTypes::UInt32 m_generation;
+	};
+
+	// indexed by NetworkIdIndex()
+	std::vector<NetworkableSlot> m_networkableSlots;
+	// indices of dynamic slots available for reuse. may contain slots that were claimed explicitly since, those are skipped on allocation
+	std::vector<PrimitiveTypes::UInt32> m_freeNetworkableSlots;
+
+	double m_timeBase;
+
+	int m_tickRate;
+	PrimitiveTypes::UInt32 m_tickNumber;
+	double m_tickTime;
+	double m_nextTickTime;
 };
 }; // namespace Components
 }; // namespace PE
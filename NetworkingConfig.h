@@ -0,0 +1,12 @@
+#ifndef __PrimeEngineNetworkingConfig_H__
+#define __PrimeEngineNetworkingConfig_H__
+
+// Dedicated server build: compile with PE_NETWORKING_HEADLESS=1 (e.g. -DPE_NETWORKING_HEADLESS=1).
+// Networking code then does not include DebugRenderer or LuaEnvironment: debugRender() methods stay callable
+// but compile to nothing and Lua bindings (SetLuaFunctions) are left out, so server binary doesn't need
+// renderer or Lua to be linked in or initialized.
+#ifndef PE_NETWORKING_HEADLESS
+#define PE_NETWORKING_HEADLESS 0
+#endif
+
+#endif
@@ -1,8 +1,37 @@
 #ifndef __PrimeEnginePacket_H__
 #define __PrimeEnginePacket_H__
 
-#define PE_PACKET_HEADER 4
-#define PE_PACKET_TOTAL_SIZE (4 * 1024)
+// packet header: size, packet id, id of latest received packet (ack), bits of 32 packets received before ack, flags
+#define PE_PACKET_HEADER 20
+
+// events and ghosts leave this much of datagram so that move and datablock chunk headers always fit
+#define PE_PACKET_STREAM_HEADERS 48
+#define PE_PACKET_ACK_BITS 32
+
+// packet carries data (not just acknowledgments) so receiver has to acknowledge it
+#define PE_PACKET_FLAG_NEEDS_ACK 1
+#define PE_PACKET_TOTAL_SIZE (4 * 1024) // packet buffer size, datagrams on the wire are limited by max datagram size of connection
+
+// datagrams bigger than path MTU get fragmented by IP and losing any fragment loses the packet
+#define PE_PACKET_DEFAULT_DATAGRAM_SIZE 1200 // safe on practically any path (IPv6 minimum MTU 1280 minus headers)
+#define PE_PACKET_MAX_DATAGRAM_SIZE 1472 // ethernet MTU 1500 minus IPv4 and UDP headers
+
+// path MTU probing: every interval one packet is padded to a bigger size, if it is acknowledged that size is safe
+#define PE_MTU_PROBE_INTERVAL 5.0 // seconds
+#define PE_MTU_PROBE_ATTEMPTS 2 // lost probes of same size before size is considered too big
+#define PE_MTU_PROBE_GRANULARITY 16 // stop searching when bounds are this close
+
+// per connection send budget (token bucket). can be negotiated on connect and changed at runtime
+#define PE_PACKET_DEFAULT_RATE 30 // packets per second
+#define PE_PACKET_MIN_RATE 1
+#define PE_PACKET_MAX_RATE 60
+#define PE_PACKET_MIN_SIZE PE_PACKET_DEFAULT_DATAGRAM_SIZE // bytes, has to fit headers of all streams, an event and a datablock fragment
+#define PE_PACKET_BURST 2 // how many packets can go back to back after connection was idle
+
+// idle connection sends a packet asking for acknowledgment this often, so that both sides know the other is alive
+#define PE_CONNECTION_KEEPALIVE_INTERVAL 1.0 // seconds
+// connection that received nothing for this long is considered dead (server default, see ServerNetworkManager::setConnectionTimeout)
+#define PE_CONNECTION_TIMEOUT 10.0 // seconds
 
 // max payload of an event sent over network
 #define PE_MAX_EVENT_PAYLOAD 512
@@ -23,6 +52,8 @@
 
 // Sibling/Children includes
 #include "EventTransmissionData.h"
+#include "GhostTransmissionData.h"
+#include "DatablockTransmissionData.h"
 
 namespace PE {
 
@@ -33,8 +64,14 @@ struct TransmissionRecord
 {
 	PrimitiveTypes::UInt32 m_id;
 
+	double m_sendTime; // network time packet was sent at, used to measure round trip time
+
 	std::vector<EventTransmissionData> m_sentEvents;
 
+	std::vector<GhostTransmissionData> m_sentGhosts;
+
+	std::vector<DatablockTransmissionData> m_sentDatablocks;
+
 	TransmissionRecord *m_pNextTransmission;
 };
 
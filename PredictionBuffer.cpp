@@ -0,0 +1,84 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "PredictionBuffer.h"
+
+// Outer-Engine includes
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+PredictionBuffer::PredictionBuffer()
+: m_pPredictable(NULL)
+, m_lastSequence(0)
+, m_lastReconciledSequence(0)
+, m_numCorrections(0)
+{
+	for (int i = 0; i < PE_PREDICTION_BUFFER_SIZE; ++i)
+	{
+		m_entries[i].m_move.m_sequence = 0;
+		m_entries[i].m_stateSize = 0;
+	}
+}
+
+void PredictionBuffer::storeState(Entry &e)
+{
+	e.m_stateSize = m_pPredictable->predict_packState(e.m_state);
+	assert(e.m_stateSize <= PE_PREDICTION_MAX_STATE_SIZE);
+}
+
+void PredictionBuffer::predictMove(const NetMove &move)
+{
+	if (!m_pPredictable)
+		return;
+
+	m_pPredictable->predict_applyMove(move);
+
+	Entry &e = entry(move.m_sequence);
+	e.m_move = move;
+	storeState(e);
+
+	m_lastSequence = move.m_sequence;
+}
+
+void PredictionBuffer::reconcile(PrimitiveTypes::Int32 ackedSequence, char *pAuthoritativeState, int stateSize)
+{
+	if (!m_pPredictable || ackedSequence <= m_lastReconciledSequence)
+		return;
+	m_lastReconciledSequence = ackedSequence;
+
+	Entry &acked = entry(ackedSequence);
+	if (acked.m_move.m_sequence == ackedSequence && acked.m_stateSize == stateSize
+		&& m_pPredictable->predict_statesMatch(acked.m_state, pAuthoritativeState, stateSize))
+	{
+		return; // predicted correctly
+	}
+
+	++m_numCorrections;
+
+	// rewind to server's state
+	m_pPredictable->predict_unpackState(pAuthoritativeState);
+	if (acked.m_move.m_sequence == ackedSequence)
+		storeState(acked);
+
+	// replay moves server hasn't processed yet. moves that fell out of the ring are lost, object snaps
+	PrimitiveTypes::Int32 firstToReplay = ackedSequence + 1;
+	if (m_lastSequence - firstToReplay >= PE_PREDICTION_BUFFER_SIZE)
+		firstToReplay = m_lastSequence - PE_PREDICTION_BUFFER_SIZE + 1;
+
+	for (PrimitiveTypes::Int32 seq = firstToReplay; seq <= m_lastSequence; ++seq)
+	{
+		Entry &e = entry(seq);
+		if (e.m_move.m_sequence != seq)
+			continue;
+
+		m_pPredictable->predict_applyMove(e.m_move);
+		storeState(e);
+	}
+}
+
+}; // namespace PE
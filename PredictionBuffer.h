@@ -0,0 +1,62 @@
+#ifndef __PrimeEnginePredictionBuffer_H__
+#define __PrimeEnginePredictionBuffer_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+#include "MoveTransmissionData.h"
+
+// number of moves client can be ahead of server. older unacknowledged moves can't be replayed
+#define PE_PREDICTION_BUFFER_SIZE 64
+
+namespace PE {
+
+// Client side prediction of the object client controls.
+// Every move is applied locally as soon as it is made and the resulting state is stored in a ring keyed
+// by move sequence. When server's authoritative state after some move arrives it is compared with the
+// state predicted for that move. On misprediction the object is rewound to the authoritative state and
+// all moves server hasn't processed yet are replayed. Storage is fixed, nothing is allocated.
+struct PredictionBuffer
+{
+	PredictionBuffer();
+
+	void setPredictable(NetPredictable *pPredictable){m_pPredictable = pPredictable;}
+
+	/// called by MoveManager for every new move: simulates it and stores predicted state
+	void predictMove(const NetMove &move);
+
+	/// called by MoveManager when server's state after move ackedSequence arrives
+	void reconcile(PrimitiveTypes::Int32 ackedSequence, char *pAuthoritativeState, int stateSize);
+
+	int getNumCorrections(){return m_numCorrections;}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	struct Entry
+	{
+		NetMove m_move; // m_move.m_sequence = 0 -> empty
+		int m_stateSize;
+		char m_state[PE_PREDICTION_MAX_STATE_SIZE]; // predicted state after the move
+	};
+
+	Entry &entry(PrimitiveTypes::Int32 sequence){return m_entries[sequence % PE_PREDICTION_BUFFER_SIZE];}
+
+	void storeState(Entry &e);
+
+	NetPredictable *m_pPredictable;
+	Entry m_entries[PE_PREDICTION_BUFFER_SIZE];
+	PrimitiveTypes::Int32 m_lastSequence; // newest predicted move
+	PrimitiveTypes::Int32 m_lastReconciledSequence;
+	int m_numCorrections;
+};
+
+}; // namespace PE
+#endif
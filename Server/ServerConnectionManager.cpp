@@ -8,7 +8,9 @@
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -21,7 +23,9 @@ extern "C"
 
 #include "PrimeEngine/Events/StandardEvents.h"
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
 
 // Sibling/Children includes
 using namespace PE::Events;
@@ -0,0 +1,116 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ServerConnectionTable.h"
+
+// Outer-Engine includes
+#include <thread>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+ServerConnectionTable::ReadGuard::ReadGuard(ServerConnectionTable &table)
+: m_table(table)
+, m_slot(-1)
+{
+	// claim free reader slot. all slots busy means too many readers, wait for one to finish
+	while (m_slot < 0)
+	{
+		for (int i = 0; i < PE_CONNECTION_TABLE_MAX_READERS; ++i)
+		{
+			bool expected = false;
+			if (!table.m_readers[i].m_used.load(std::memory_order_relaxed) && table.m_readers[i].m_used.compare_exchange_strong(expected, true))
+			{
+				m_slot = i;
+				break;
+			}
+		}
+		if (m_slot < 0)
+			std::this_thread::yield();
+	}
+
+	// announce epoch before loading snapshot. writer that retires after this sees us and waits
+	table.m_readers[m_slot].m_epoch.store(table.m_epoch.load());
+	m_pSnapshot = table.m_pCurrent.load();
+}
+
+ServerConnectionTable::ReadGuard::~ReadGuard()
+{
+	m_table.m_readers[m_slot].m_epoch.store(0);
+	m_table.m_readers[m_slot].m_used.store(false);
+}
+
+ServerConnectionTable::ServerConnectionTable()
+: m_pCurrent(new Snapshot())
+, m_epoch(1)
+{
+	for (int i = 0; i < PE_CONNECTION_TABLE_MAX_READERS; ++i)
+	{
+		m_readers[i].m_used.store(false);
+		m_readers[i].m_epoch.store(0);
+	}
+}
+
+ServerConnectionTable::~ServerConnectionTable()
+{
+	for (unsigned int i = 0; i < m_retired.size(); ++i)
+		delete m_retired[i].m_pSnapshot;
+	delete m_pCurrent.load();
+}
+
+unsigned long long ServerConnectionTable::setContext(int clientId, NetworkContext *pContext)
+{
+	assert(clientId >= 0);
+	Snapshot *pOld = m_pCurrent.load();
+	Snapshot *pNew = new Snapshot(*pOld);
+
+	if (clientId >= (int)(pNew->m_contexts.size()))
+		pNew->m_contexts.resize(clientId + 1, NULL);
+	pNew->m_contexts[clientId] = pContext;
+
+	pNew->m_clientIds.clear();
+	for (unsigned int i = 0; i < pNew->m_contexts.size(); ++i)
+	{
+		if (pNew->m_contexts[i])
+			pNew->m_clientIds.push_back(i);
+	}
+
+	// readers that announced an epoch older than the new one may still hold old snapshot
+	m_pCurrent.store(pNew);
+	unsigned long long retireEpoch = m_epoch.fetch_add(1) + 1;
+
+	RetiredSnapshot retired = {pOld, retireEpoch};
+	m_retired.push_back(retired);
+
+	return retireEpoch;
+}
+
+bool ServerConnectionTable::isSafe(unsigned long long epoch)
+{
+	for (int i = 0; i < PE_CONNECTION_TABLE_MAX_READERS; ++i)
+	{
+		unsigned long long readerEpoch = m_readers[i].m_epoch.load();
+		if (readerEpoch && readerEpoch < epoch)
+			return false;
+	}
+	return true;
+}
+
+void ServerConnectionTable::reclaim()
+{
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < m_retired.size(); ++i)
+	{
+		if (isSafe(m_retired[i].m_epoch))
+			delete m_retired[i].m_pSnapshot;
+		else
+			m_retired[kept++] = m_retired[i];
+	}
+	m_retired.resize(kept);
+}
+
+}; // namespace PE
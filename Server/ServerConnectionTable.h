@@ -0,0 +1,92 @@
+#ifndef __PrimeEngineServerConnectionTable_H__
+#define __PrimeEngineServerConnectionTable_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <vector>
+#include <atomic>
+
+// Inter-Engine includes
+
+#include "PrimeEngine/Networking/NetworkContext.h"
+
+// Sibling/Children includes
+
+// max number of read guards alive at the same time (threads reading the table, nested guards count separately)
+#define PE_CONNECTION_TABLE_MAX_READERS 32
+
+namespace PE {
+
+// Connection table published as immutable snapshots (read-copy-update).
+// Readers (debug render, stats, broadcast fan-out) pin the current snapshot with a ReadGuard; they never lock and
+// never block the writer. The writer (game thread: accept and teardown) copies the snapshot, changes the copy
+// and publishes it. Old snapshots, and anything else only reachable from them (e.g. torn down connection contexts),
+// are retired with the epoch returned by publish and may be freed once isSafe(epoch): every reader that could
+// have seen them has finished.
+struct ServerConnectionTable
+{
+	struct Snapshot
+	{
+		std::vector<NetworkContext *> m_contexts; // indexed by client id, NULL = no client
+		std::vector<int> m_clientIds; // connected clients, ascending
+
+		NetworkContext *getContext(int clientId) const {return clientId >= 0 && clientId < (int)(m_contexts.size()) ? m_contexts[clientId] : NULL;}
+	};
+
+	// pins snapshot that was current when guard was created for guard's lifetime
+	struct ReadGuard
+	{
+		ReadGuard(ServerConnectionTable &table);
+		~ReadGuard();
+
+		const Snapshot &snapshot(){return *m_pSnapshot;}
+
+		ServerConnectionTable &m_table;
+		int m_slot;
+		const Snapshot *m_pSnapshot;
+	};
+
+	ServerConnectionTable();
+	~ServerConnectionTable();
+
+	// Writer (single thread) ----------------------------------------------
+	/// writer's own view, no guard needed on writer thread
+	const Snapshot &current(){return *m_pCurrent.load(std::memory_order_relaxed);}
+
+	/// publishes copy of current snapshot with context of client set (NULL removes client). returns retire epoch
+	unsigned long long setContext(int clientId, NetworkContext *pContext);
+
+	/// true when no reader can still see what was retired at epoch
+	bool isSafe(unsigned long long epoch);
+
+	/// frees retired snapshots no reader can see anymore
+	void reclaim();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	// one cache line per reader, so that readers entering and leaving don't invalidate each other's line
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic<bool> m_used;
+		std::atomic<unsigned long long> m_epoch; // epoch reader entered at, 0 = not reading
+	};
+
+	struct RetiredSnapshot
+	{
+		Snapshot *m_pSnapshot;
+		unsigned long long m_epoch;
+	};
+
+	std::atomic<Snapshot *> m_pCurrent;
+	std::atomic<unsigned long long> m_epoch; // starts at 1
+	ReaderSlot m_readers[PE_CONNECTION_TABLE_MAX_READERS];
+	std::vector<RetiredSnapshot> m_retired;
+};
+
+}; // namespace PE
+#endif
@@ -0,0 +1,97 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ServerHandshake.h"
+
+// Outer-Engine includes
+#include <math.h>
+#include <random>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+ServerHandshake::ServerHandshake()
+{
+	std::random_device rd;
+	for (int i = 0; i < 2; ++i)
+		m_key[i] = ((unsigned long long)(rd()) << 32) ^ rd();
+}
+
+ServerHandshake::Cookie ServerHandshake::makeCookieForPeriod(PrimitiveTypes::UInt32 ip, PrimitiveTypes::UInt16 port, long long period)
+{
+	unsigned char data[14];
+	for (int i = 0; i < 4; ++i)
+		data[i] = (unsigned char)(ip >> (8 * i));
+	data[4] = (unsigned char)(port);
+	data[5] = (unsigned char)(port >> 8);
+	for (int i = 0; i < 8; ++i)
+		data[6 + i] = (unsigned char)((unsigned long long)(period) >> (8 * i));
+
+	return SipHash24(m_key, data, sizeof(data));
+}
+
+ServerHandshake::Cookie ServerHandshake::makeCookie(PrimitiveTypes::UInt32 ip, PrimitiveTypes::UInt16 port, double now)
+{
+	return makeCookieForPeriod(ip, port, (long long)(floor(now / PE_SERVER_COOKIE_LIFETIME)));
+}
+
+bool ServerHandshake::checkCookie(PrimitiveTypes::UInt32 ip, PrimitiveTypes::UInt16 port, Cookie cookie, double now)
+{
+	long long period = (long long)(floor(now / PE_SERVER_COOKIE_LIFETIME));
+
+	// cookie handed out just before period changed is still good
+	return cookie == makeCookieForPeriod(ip, port, period) || cookie == makeCookieForPeriod(ip, port, period - 1);
+}
+
+#define PE_SIPROUND(v0, v1, v2, v3) \
+	v0 += v1; v1 = (v1 << 13) | (v1 >> 51); v1 ^= v0; v0 = (v0 << 32) | (v0 >> 32); \
+	v2 += v3; v3 = (v3 << 16) | (v3 >> 48); v3 ^= v2; \
+	v0 += v3; v3 = (v3 << 21) | (v3 >> 43); v3 ^= v0; \
+	v2 += v1; v1 = (v1 << 17) | (v1 >> 47); v1 ^= v2; v2 = (v2 << 32) | (v2 >> 32);
+
+unsigned long long ServerHandshake::SipHash24(const unsigned long long key[2], const unsigned char *pData, int size)
+{
+	unsigned long long v0 = 0x736f6d6570736575ULL ^ key[0];
+	unsigned long long v1 = 0x646f72616e646f6dULL ^ key[1];
+	unsigned long long v2 = 0x6c7967656e657261ULL ^ key[0];
+	unsigned long long v3 = 0x7465646279746573ULL ^ key[1];
+
+	int numWords = size / 8;
+	for (int iWord = 0; iWord < numWords; ++iWord)
+	{
+		unsigned long long m = 0;
+		for (int i = 0; i < 8; ++i)
+			m |= (unsigned long long)(pData[iWord * 8 + i]) << (8 * i);
+
+		v3 ^= m;
+		PE_SIPROUND(v0, v1, v2, v3);
+		PE_SIPROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+
+	// last block: remaining bytes and message length in top byte
+	unsigned long long b = (unsigned long long)(size) << 56;
+	for (int i = 0; i < size % 8; ++i)
+		b |= (unsigned long long)(pData[numWords * 8 + i]) << (8 * i);
+
+	v3 ^= b;
+	PE_SIPROUND(v0, v1, v2, v3);
+	PE_SIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+
+	v2 ^= 0xff;
+	PE_SIPROUND(v0, v1, v2, v3);
+	PE_SIPROUND(v0, v1, v2, v3);
+	PE_SIPROUND(v0, v1, v2, v3);
+	PE_SIPROUND(v0, v1, v2, v3);
+
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef PE_SIPROUND
+
+}; // namespace PE
@@ -0,0 +1,51 @@
+#ifndef __PrimeEngineServerHandshake_H__
+#define __PrimeEngineServerHandshake_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+// seconds a connect cookie is valid for. cookies of current and previous period are accepted
+#define PE_SERVER_COOKIE_LIFETIME 10.0
+
+// max datagrams read from listening socket per tick, the rest waits for next tick
+#define PE_SERVER_MAX_REQUESTS_PER_TICK 64
+
+namespace PE {
+
+// Stateless connect cookies.
+// First connect request of a client is answered with a challenge carrying a cookie, a keyed hash (SipHash-2-4) of
+// client's address, port and current time period. Nothing is stored. Only when client sends its connect request
+// again with the cookie echoed back does server allocate socket and connection context (see HandshakeMessage). Spoofed source addresses
+// never see the cookie, so request floods cost one hash and one small reply each.
+struct ServerHandshake
+{
+	typedef unsigned long long Cookie;
+
+	/// generates new random secret
+	ServerHandshake();
+
+	/// ip and port in network byte order as in sockaddr_in
+	Cookie makeCookie(PrimitiveTypes::UInt32 ip, PrimitiveTypes::UInt16 port, double now);
+
+	bool checkCookie(PrimitiveTypes::UInt32 ip, PrimitiveTypes::UInt16 port, Cookie cookie, double now);
+
+	static unsigned long long SipHash24(const unsigned long long key[2], const unsigned char *pData, int size);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	Cookie makeCookieForPeriod(PrimitiveTypes::UInt32 ip, PrimitiveTypes::UInt16 port, long long period);
+
+	unsigned long long m_key[2];
+};
+
+}; // namespace PE
+#endif
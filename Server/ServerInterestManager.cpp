@@ -0,0 +1,306 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ServerInterestManager.h"
+
+// Outer-Engine includes
+#include <math.h>
+
+// Inter-Engine includes
+
+#include "PrimeEngine/Networking/NetworkManager.h"
+#include "PrimeEngine/Networking/GhostManager.h"
+
+// Sibling/Children includes
+
+namespace PE {
+
+ServerInterestManager::ServerInterestManager()
+: m_cellSize(PE_INTEREST_CELL_SIZE)
+{
+}
+
+ServerInterestManager::~ServerInterestManager()
+{
+}
+
+ServerInterestManager::Cell *ServerInterestManager::findCell(int cellX, int cellZ)
+{
+	std::unordered_map<CellKey, Cell>::iterator i = m_cells.find(MakeCellKey(cellX, cellZ));
+	if (i == m_cells.end())
+		return NULL;
+	return &i->second;
+}
+
+int ServerInterestManager::findObject(Networkable::NetworkId networkId)
+{
+	PrimitiveTypes::UInt32 slotIndex = Components::NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_objectIndexBySlot.size())
+		return -1;
+
+	int iObject = m_objectIndexBySlot[slotIndex];
+	if (iObject < 0 || m_objects[iObject].m_networkId != networkId)
+		return -1;
+
+	return iObject;
+}
+
+bool ServerInterestManager::coversCell(const Client &client, int cellX, int cellZ)
+{
+	return abs(cellX - client.m_cellX) <= client.m_viewRadiusCells
+		&& abs(cellZ - client.m_cellZ) <= client.m_viewRadiusCells;
+}
+
+void ServerInterestManager::enterScope(Client &client, Object &object)
+{
+	client.m_pGhostManager->ghostObject(object.m_networkId, object.m_pGhostable);
+}
+
+void ServerInterestManager::exitScope(Client &client, Object &object)
+{
+	client.m_pGhostManager->unghostObject(object.m_networkId);
+}
+
+void ServerInterestManager::addObject(Networkable::NetworkId networkId, NetGhostable *pGhostable)
+{
+	assert(findObject(networkId) < 0);
+
+	Vector3 pos = pGhostable->ghost_getPosition();
+
+	Object object;
+	object.m_networkId = networkId;
+	object.m_pGhostable = pGhostable;
+	object.m_cellX = cellCoord(pos.m_x);
+	object.m_cellZ = cellCoord(pos.m_z);
+
+	PrimitiveTypes::UInt32 slotIndex = Components::NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_objectIndexBySlot.size())
+		m_objectIndexBySlot.resize(slotIndex + 1, -1);
+	m_objectIndexBySlot[slotIndex] = (int)(m_objects.size());
+	m_objects.push_back(object);
+
+	Cell &cell = getCell(object.m_cellX, object.m_cellZ);
+	cell.m_objects.push_back(networkId);
+
+	for (unsigned int i = 0; i < cell.m_viewers.size(); ++i)
+		enterScope(m_clients[cell.m_viewers[i]], m_objects.back());
+}
+
+void ServerInterestManager::removeObject(Networkable::NetworkId networkId)
+{
+	int iObject = findObject(networkId);
+	if (iObject < 0)
+		return;
+
+	Object &object = m_objects[iObject];
+	if (Cell *pCell = findCell(object.m_cellX, object.m_cellZ))
+	{
+		for (unsigned int i = 0; i < pCell->m_viewers.size(); ++i)
+			exitScope(m_clients[pCell->m_viewers[i]], object);
+
+		removeFromList(pCell->m_objects, networkId);
+	}
+
+	// swap with last to keep array dense
+	int iLast = (int)(m_objects.size()) - 1;
+	if (iObject != iLast)
+	{
+		m_objects[iObject] = m_objects[iLast];
+		m_objectIndexBySlot[Components::NetworkManager::NetworkIdIndex(m_objects[iObject].m_networkId)] = iObject;
+	}
+	m_objects.pop_back();
+	m_objectIndexBySlot[Components::NetworkManager::NetworkIdIndex(networkId)] = -1;
+}
+
+void ServerInterestManager::moveObject(Networkable::NetworkId networkId, const Vector3 &position)
+{
+	int iObject = findObject(networkId);
+	if (iObject < 0)
+		return;
+
+	Object &object = m_objects[iObject];
+	int newCellX = cellCoord(position.m_x);
+	int newCellZ = cellCoord(position.m_z);
+	if (newCellX == object.m_cellX && newCellZ == object.m_cellZ)
+		return; // same cell, scope doesn't change
+
+	int oldCellX = object.m_cellX;
+	int oldCellZ = object.m_cellZ;
+	object.m_cellX = newCellX;
+	object.m_cellZ = newCellZ;
+
+	Cell *pOldCell = findCell(oldCellX, oldCellZ);
+	if (pOldCell)
+	{
+		removeFromList(pOldCell->m_objects, networkId);
+
+		// viewers of old cell that don't see new cell lose the object
+		for (unsigned int i = 0; i < pOldCell->m_viewers.size(); ++i)
+		{
+			Client &client = m_clients[pOldCell->m_viewers[i]];
+			if (!coversCell(client, newCellX, newCellZ))
+				exitScope(client, object);
+		}
+	}
+
+	Cell &newCell = getCell(newCellX, newCellZ);
+	newCell.m_objects.push_back(networkId);
+
+	// viewers of new cell that didn't see old cell get the object
+	for (unsigned int i = 0; i < newCell.m_viewers.size(); ++i)
+	{
+		Client &client = m_clients[newCell.m_viewers[i]];
+		if (!coversCell(client, oldCellX, oldCellZ))
+			enterScope(client, object);
+	}
+}
+
+void ServerInterestManager::updateObjects()
+{
+	for (unsigned int i = 0; i < m_objects.size(); ++i)
+		moveObject(m_objects[i].m_networkId, m_objects[i].m_pGhostable->ghost_getPosition());
+}
+
+void ServerInterestManager::addClient(int clientId, Components::GhostManager *pGhostManager, int viewRadiusCells)
+{
+	if (clientId >= (int)(m_clients.size()))
+	{
+		Client unused;
+		unused.m_pGhostManager = NULL;
+		m_clients.resize(clientId + 1, unused);
+	}
+
+	Client &client = m_clients[clientId];
+	assert(!client.m_pGhostManager);
+
+	client.m_pGhostManager = pGhostManager;
+	client.m_position = Vector3(0, 0, 0);
+	client.m_cellX = 0;
+	client.m_cellZ = 0;
+	client.m_viewRadiusCells = viewRadiusCells;
+
+	getCell(0, 0).m_clients.push_back(clientId);
+
+	for (int cellX = client.m_cellX - viewRadiusCells; cellX <= client.m_cellX + viewRadiusCells; ++cellX)
+	{
+		for (int cellZ = client.m_cellZ - viewRadiusCells; cellZ <= client.m_cellZ + viewRadiusCells; ++cellZ)
+		{
+			Cell &cell = getCell(cellX, cellZ);
+			cell.m_viewers.push_back(clientId);
+			for (unsigned int i = 0; i < cell.m_objects.size(); ++i)
+				enterScope(client, m_objects[findObject(cell.m_objects[i])]);
+		}
+	}
+}
+
+void ServerInterestManager::removeClient(int clientId)
+{
+	if (clientId >= (int)(m_clients.size()) || !m_clients[clientId].m_pGhostManager)
+		return;
+
+	Client &client = m_clients[clientId];
+
+	// ghost manager goes away with connection, just drop the client from cells
+	for (int cellX = client.m_cellX - client.m_viewRadiusCells; cellX <= client.m_cellX + client.m_viewRadiusCells; ++cellX)
+	{
+		for (int cellZ = client.m_cellZ - client.m_viewRadiusCells; cellZ <= client.m_cellZ + client.m_viewRadiusCells; ++cellZ)
+		{
+			if (Cell *pCell = findCell(cellX, cellZ))
+				removeFromList(pCell->m_viewers, clientId);
+		}
+	}
+
+	if (Cell *pCell = findCell(client.m_cellX, client.m_cellZ))
+		removeFromList(pCell->m_clients, clientId);
+
+	client.m_pGhostManager = NULL;
+}
+
+void ServerInterestManager::moveClient(int clientId, const Vector3 &position)
+{
+	assert(clientId < (int)(m_clients.size()) && m_clients[clientId].m_pGhostManager);
+	Client &client = m_clients[clientId];
+	client.m_position = position;
+
+	int newCellX = cellCoord(position.m_x);
+	int newCellZ = cellCoord(position.m_z);
+	if (newCellX == client.m_cellX && newCellZ == client.m_cellZ)
+		return; // same cell, scope doesn't change
+
+	int r = client.m_viewRadiusCells;
+	int oldCellX = client.m_cellX;
+	int oldCellZ = client.m_cellZ;
+
+	if (Cell *pCell = findCell(oldCellX, oldCellZ))
+		removeFromList(pCell->m_clients, clientId);
+	getCell(newCellX, newCellZ).m_clients.push_back(clientId);
+
+	// cells that are no longer in view
+	for (int cellX = oldCellX - r; cellX <= oldCellX + r; ++cellX)
+	{
+		for (int cellZ = oldCellZ - r; cellZ <= oldCellZ + r; ++cellZ)
+		{
+			if (abs(cellX - newCellX) <= r && abs(cellZ - newCellZ) <= r)
+				continue; // still in view
+
+			Cell *pCell = findCell(cellX, cellZ);
+			if (!pCell)
+				continue;
+
+			removeFromList(pCell->m_viewers, clientId);
+			for (unsigned int i = 0; i < pCell->m_objects.size(); ++i)
+				exitScope(client, m_objects[findObject(pCell->m_objects[i])]);
+		}
+	}
+
+	// cells that came into view
+	for (int cellX = newCellX - r; cellX <= newCellX + r; ++cellX)
+	{
+		for (int cellZ = newCellZ - r; cellZ <= newCellZ + r; ++cellZ)
+		{
+			if (abs(cellX - oldCellX) <= r && abs(cellZ - oldCellZ) <= r)
+				continue; // was in view already
+
+			Cell &cell = getCell(cellX, cellZ);
+			cell.m_viewers.push_back(clientId);
+			for (unsigned int i = 0; i < cell.m_objects.size(); ++i)
+				enterScope(client, m_objects[findObject(cell.m_objects[i])]);
+		}
+	}
+
+	client.m_cellX = newCellX;
+	client.m_cellZ = newCellZ;
+}
+
+void ServerInterestManager::findClientsInRadius(const Vector3 &position, float radius, std::vector<int> &out_clientIds)
+{
+	int minCellX = cellCoord(position.m_x - radius);
+	int maxCellX = cellCoord(position.m_x + radius);
+	int minCellZ = cellCoord(position.m_z - radius);
+	int maxCellZ = cellCoord(position.m_z + radius);
+
+	float radiusSqr = radius * radius;
+
+	for (int cellX = minCellX; cellX <= maxCellX; ++cellX)
+	{
+		for (int cellZ = minCellZ; cellZ <= maxCellZ; ++cellZ)
+		{
+			Cell *pCell = findCell(cellX, cellZ);
+			if (!pCell)
+				continue;
+
+			for (unsigned int i = 0; i < pCell->m_clients.size(); ++i)
+			{
+				Client &client = m_clients[pCell->m_clients[i]];
+				float dx = client.m_position.m_x - position.m_x;
+				float dy = client.m_position.m_y - position.m_y;
+				float dz = client.m_position.m_z - position.m_z;
+				if (dx * dx + dy * dy + dz * dz <= radiusSqr)
+					out_clientIds.push_back(pCell->m_clients[i]);
+			}
+		}
+	}
+}
+
+}; // namespace PE
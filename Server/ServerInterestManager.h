@@ -0,0 +1,132 @@
+#ifndef __PrimeEngineServerInterestManager_H__
+#define __PrimeEngineServerInterestManager_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include <unordered_map>
+
+// Inter-Engine includes
+
+#include "PrimeEngine/Utils/Networkable.h"
+#include "PrimeEngine/Math/Vector3.h"
+
+// Sibling/Children includes
+
+#include "PrimeEngine/Networking/GhostTransmissionData.h"
+
+// size of interest grid cell in world units
+#define PE_INTEREST_CELL_SIZE 50.0f
+
+// how many cells around the client's cell are in scope
+#define PE_INTEREST_VIEW_RADIUS_CELLS 2
+
+namespace PE {
+
+namespace Components {
+	struct GhostManager;
+};
+
+// Decides which ghostable objects are in scope of which client.
+// Objects and client viewpoints live in a uniform grid on the horizontal (x, z) plane.
+// An object is in scope of a client if its cell is within view radius (in cells) of client's cell.
+// Scope is updated incrementally: only when an object or a viewpoint moves to a different cell,
+// and only for the cells that changed, objects are ghosted to/unghosted from the client's GhostManager.
+struct ServerInterestManager
+{
+	ServerInterestManager();
+	~ServerInterestManager();
+
+	void setCellSize(float cellSize){assert(!m_objects.size()); m_cellSize = cellSize;}
+
+	// Objects -----------------------------------------------------------------
+	void addObject(Networkable::NetworkId networkId, NetGhostable *pGhostable);
+	void removeObject(Networkable::NetworkId networkId);
+
+	// call when object moves. does work only if object moved to another cell
+	void moveObject(Networkable::NetworkId networkId, const Vector3 &position);
+
+	// polls positions of all objects (NetGhostable::ghost_getPosition) and moves them
+	void updateObjects();
+
+	// Clients -----------------------------------------------------------------
+	void addClient(int clientId, Components::GhostManager *pGhostManager, int viewRadiusCells = PE_INTEREST_VIEW_RADIUS_CELLS);
+	void removeClient(int clientId);
+
+	// call when client's viewpoint moves. does work only if it moved to another cell
+	void moveClient(int clientId, const Vector3 &position);
+
+	// Queries -----------------------------------------------------------------
+	// fills in ids of clients whose viewpoint is within radius of position. only cells that overlap the radius are visited
+	void findClientsInRadius(const Vector3 &position, float radius, std::vector<int> &out_clientIds);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	struct Cell
+	{
+		std::vector<Networkable::NetworkId> m_objects; // objects in this cell
+		std::vector<int> m_viewers; // clients that have this cell in scope
+		std::vector<int> m_clients; // clients whose viewpoint is in this cell
+	};
+
+	struct Object
+	{
+		Networkable::NetworkId m_networkId;
+		NetGhostable *m_pGhostable;
+		int m_cellX, m_cellZ;
+	};
+
+	struct Client
+	{
+		Components::GhostManager *m_pGhostManager; // NULL = slot not used
+		Vector3 m_position;
+		int m_cellX, m_cellZ;
+		int m_viewRadiusCells;
+	};
+
+	typedef long long CellKey;
+	static CellKey MakeCellKey(int cellX, int cellZ){return ((CellKey)(cellX) << 32) | (PrimitiveTypes::UInt32)(cellZ);}
+
+	int cellCoord(float v){return (int)(floorf(v / m_cellSize));}
+	Cell &getCell(int cellX, int cellZ){return m_cells[MakeCellKey(cellX, cellZ)];}
+	Cell *findCell(int cellX, int cellZ);
+	int findObject(Networkable::NetworkId networkId);
+
+	static bool coversCell(const Client &client, int cellX, int cellZ);
+
+	void enterScope(Client &client, Object &object);
+	void exitScope(Client &client, Object &object);
+
+	template <typename T>
+	static void removeFromList(std::vector<T> &list, T v)
+	{
+		for (unsigned int i = 0; i < list.size(); ++i)
+		{
+			if (list[i] == v)
+			{
+				list[i] = list.back();
+				list.pop_back();
+				return;
+			}
+		}
+	}
+
+	float m_cellSize;
+
+	std::unordered_map<CellKey, Cell> m_cells;
+
+	std::vector<Object> m_objects;
+	std::vector<int> m_objectIndexBySlot; // networkable slot index -> index in m_objects or -1
+
+	std::vector<Client> m_clients; // indexed by client id
+};
+
+}; // namespace PE
+#endif
@@ -0,0 +1,233 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ServerLagCompensation.h"
+
+// Outer-Engine includes
+#include <math.h>
+
+// Inter-Engine includes
+
+#include "PrimeEngine/Networking/NetworkManager.h"
+
+// Sibling/Children includes
+
+namespace PE {
+
+ServerLagCompensation::ServerLagCompensation()
+: m_numColumns(0)
+, m_numTicksRecorded(0)
+{
+	for (int i = 0; i < PE_LAG_MAX_ENTITIES; ++i)
+	{
+		m_entityIds[i] = 0;
+		m_pGhostables[i] = NULL;
+		m_addedAtTick[i] = 0;
+	}
+
+	m_posX.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+	m_posY.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+	m_posZ.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+	m_rotX.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+	m_rotY.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+	m_rotZ.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+	m_rotW.resize(PE_LAG_HISTORY_TICKS * PE_LAG_MAX_ENTITIES);
+
+	for (int i = 0; i < PE_LAG_HISTORY_TICKS; ++i)
+	{
+		m_tickTimes[i] = 0;
+		m_tickNumbers[i] = -1;
+	}
+}
+
+int ServerLagCompensation::findColumn(Networkable::NetworkId networkId)
+{
+	PrimitiveTypes::UInt32 slotIndex = Components::NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_columnBySlot.size())
+		return -1;
+
+	int column = m_columnBySlot[slotIndex];
+	if (column < 0 || m_entityIds[column] != networkId)
+		return -1;
+
+	return column;
+}
+
+bool ServerLagCompensation::addEntity(Networkable::NetworkId networkId, NetGhostable *pGhostable)
+{
+	assert(findColumn(networkId) < 0);
+
+	int column;
+	if (m_freeColumns.size())
+	{
+		column = m_freeColumns.back();
+		m_freeColumns.pop_back();
+	}
+	else if (m_numColumns < PE_LAG_MAX_ENTITIES)
+	{
+		column = m_numColumns++;
+	}
+	else
+	{
+		PEINFO("ServerLagCompensation: no room for entity %d, it will not be lag compensated\n", (int)(networkId));
+		return false;
+	}
+
+	m_entityIds[column] = networkId;
+	m_pGhostables[column] = pGhostable;
+	m_addedAtTick[column] = m_numTicksRecorded; // older ticks belong to previous owner of column
+
+	PrimitiveTypes::UInt32 slotIndex = Components::NetworkManager::NetworkIdIndex(networkId);
+	if (slotIndex >= m_columnBySlot.size())
+		m_columnBySlot.resize(slotIndex + 1, -1);
+	m_columnBySlot[slotIndex] = column;
+
+	return true;
+}
+
+void ServerLagCompensation::removeEntity(Networkable::NetworkId networkId)
+{
+	int column = findColumn(networkId);
+	if (column < 0)
+		return;
+
+	m_pGhostables[column] = NULL;
+	m_entityIds[column] = 0;
+	m_columnBySlot[Components::NetworkManager::NetworkIdIndex(networkId)] = -1;
+	m_freeColumns.push_back(column);
+}
+
+void ServerLagCompensation::recordTick(double time)
+{
+	int tick = m_numTicksRecorded % PE_LAG_HISTORY_TICKS;
+	m_tickTimes[tick] = time;
+	m_tickNumbers[tick] = m_numTicksRecorded;
+
+	int base = Index(tick, 0);
+	for (int column = 0; column < m_numColumns; ++column)
+	{
+		NetGhostable *pGhostable = m_pGhostables[column];
+		if (!pGhostable)
+			continue;
+
+		Vector3 pos = pGhostable->ghost_getPosition();
+		Vector4 rot = pGhostable->ghost_getOrientation();
+
+		m_posX[base + column] = pos.m_x;
+		m_posY[base + column] = pos.m_y;
+		m_posZ[base + column] = pos.m_z;
+		m_rotX[base + column] = rot.m_x;
+		m_rotY[base + column] = rot.m_y;
+		m_rotZ[base + column] = rot.m_z;
+		m_rotW[base + column] = rot.m_w;
+	}
+
+	++m_numTicksRecorded;
+}
+
+bool ServerLagCompensation::findRewind(double time, Rewind &out_rewind)
+{
+	if (!m_numTicksRecorded)
+		return false;
+
+	int numTicks = m_numTicksRecorded < PE_LAG_HISTORY_TICKS ? m_numTicksRecorded : PE_LAG_HISTORY_TICKS;
+	PrimitiveTypes::Int32 newest = m_numTicksRecorded - 1;
+	PrimitiveTypes::Int32 oldest = m_numTicksRecorded - numTicks;
+
+	if (time >= m_tickTimes[newest % PE_LAG_HISTORY_TICKS])
+	{
+		out_rewind.m_tickFrom = out_rewind.m_tickTo = newest % PE_LAG_HISTORY_TICKS;
+		out_rewind.m_alpha = 0;
+		return true;
+	}
+
+	if (time <= m_tickTimes[oldest % PE_LAG_HISTORY_TICKS])
+	{
+		// client is further behind than history goes
+		out_rewind.m_tickFrom = out_rewind.m_tickTo = oldest % PE_LAG_HISTORY_TICKS;
+		out_rewind.m_alpha = 0;
+		return true;
+	}
+
+	// last tick at or before time. tick times increase with tick number
+	PrimitiveTypes::Int32 lo = oldest, hi = newest;
+	while (lo < hi)
+	{
+		PrimitiveTypes::Int32 mid = (lo + hi + 1) / 2;
+		if (m_tickTimes[mid % PE_LAG_HISTORY_TICKS] <= time)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	out_rewind.m_tickFrom = lo % PE_LAG_HISTORY_TICKS;
+	out_rewind.m_tickTo = (lo + 1) % PE_LAG_HISTORY_TICKS;
+
+	double from = m_tickTimes[out_rewind.m_tickFrom];
+	double to = m_tickTimes[out_rewind.m_tickTo];
+	out_rewind.m_alpha = (float)((time - from) / (to - from));
+
+	return true;
+}
+
+bool ServerLagCompensation::blendFactor(const Rewind &rewind, int column, float &out_alpha)
+{
+	PrimitiveTypes::Int32 addedAt = m_addedAtTick[column];
+
+	if (m_tickNumbers[rewind.m_tickTo] < addedAt)
+		return false; // tick to is the newer one, entity is in neither
+
+	out_alpha = m_tickNumbers[rewind.m_tickFrom] >= addedAt ? rewind.m_alpha : 1.0f;
+	return true;
+}
+
+bool ServerLagCompensation::getPosition(const Rewind &rewind, Networkable::NetworkId networkId, Vector3 &out_position)
+{
+	int column = findColumn(networkId);
+	float a;
+	if (column < 0 || !blendFactor(rewind, column, a))
+		return false;
+
+	int from = Index(rewind.m_tickFrom, column);
+	int to = Index(rewind.m_tickTo, column);
+
+	out_position.m_x = m_posX[from] + (m_posX[to] - m_posX[from]) * a;
+	out_position.m_y = m_posY[from] + (m_posY[to] - m_posY[from]) * a;
+	out_position.m_z = m_posZ[from] + (m_posZ[to] - m_posZ[from]) * a;
+	return true;
+}
+
+bool ServerLagCompensation::getOrientation(const Rewind &rewind, Networkable::NetworkId networkId, Vector4 &out_orientation)
+{
+	int column = findColumn(networkId);
+	float a;
+	if (column < 0 || !blendFactor(rewind, column, a))
+		return false;
+
+	int from = Index(rewind.m_tickFrom, column);
+	int to = Index(rewind.m_tickTo, column);
+
+	// normalized lerp along the shorter arc
+	float dot = m_rotX[from] * m_rotX[to] + m_rotY[from] * m_rotY[to] + m_rotZ[from] * m_rotZ[to] + m_rotW[from] * m_rotW[to];
+	float sign = dot < 0 ? -1.0f : 1.0f;
+
+	float x = m_rotX[from] + (m_rotX[to] * sign - m_rotX[from]) * a;
+	float y = m_rotY[from] + (m_rotY[to] * sign - m_rotY[from]) * a;
+	float z = m_rotZ[from] + (m_rotZ[to] * sign - m_rotZ[from]) * a;
+	float w = m_rotW[from] + (m_rotW[to] * sign - m_rotW[from]) * a;
+
+	float len = sqrtf(x * x + y * y + z * z + w * w);
+	if (len > 0)
+	{
+		x /= len; y /= len; z /= len; w /= len;
+	}
+
+	out_orientation.m_x = x;
+	out_orientation.m_y = y;
+	out_orientation.m_z = z;
+	out_orientation.m_w = w;
+	return true;
+}
+
+}; // namespace PE
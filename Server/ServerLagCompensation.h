@@ -0,0 +1,95 @@
+#ifndef __PrimeEngineServerLagCompensation_H__
+#define __PrimeEngineServerLagCompensation_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <vector>
+
+// Inter-Engine includes
+
+#include "PrimeEngine/Utils/Networkable.h"
+#include "PrimeEngine/Math/Vector3.h"
+#include "PrimeEngine/Math/Matrix4x4.h"
+
+// Sibling/Children includes
+
+#include "PrimeEngine/Networking/GhostTransmissionData.h"
+
+// number of ticks of history kept
+#define PE_LAG_HISTORY_TICKS 64
+
+// max number of entities recorded
+#define PE_LAG_MAX_ENTITIES 512
+
+namespace PE {
+
+// Transforms of networked entities for the last PE_LAG_HISTORY_TICKS ticks, so that server can check hits
+// and collisions against where entities were on a client's screen when it acted.
+// Storage is structure of arrays, one array per transform component, tick major: a tick's record is
+// written as contiguous runs. Everything is allocated once at construction.
+struct ServerLagCompensation
+{
+	ServerLagCompensation();
+
+	/// returns false if there is no room for more entities
+	bool addEntity(Networkable::NetworkId networkId, NetGhostable *pGhostable);
+	void removeEntity(Networkable::NetworkId networkId);
+
+	/// called once per server tick. polls transforms of all entities (NetGhostable::ghost_getPosition/ghost_getOrientation)
+	void recordTick(double time);
+
+	/// time the client saw on screen when it acted: its input took rtt / 2 to get here and it renders interpolationDelay behind
+	static double ComputeViewTime(double serverTime, float rtt, float interpolationDelay)
+	{
+		return serverTime - rtt * 0.5 - interpolationDelay;
+	}
+
+	// Rewinding ---------------------------------------------------------------
+	// found once per query time, then used to look up any number of entities
+	struct Rewind
+	{
+		int m_tickFrom, m_tickTo; // ring indices
+		float m_alpha; // 0 = m_tickFrom, 1 = m_tickTo
+	};
+
+	/// time is clamped to recorded history. returns false if nothing is recorded yet
+	bool findRewind(double time, Rewind &out_rewind);
+
+	/// return false if entity is not recorded or was added after rewound time
+	bool getPosition(const Rewind &rewind, Networkable::NetworkId networkId, Vector3 &out_position);
+	bool getOrientation(const Rewind &rewind, Networkable::NetworkId networkId, Vector4 &out_orientation);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	int findColumn(Networkable::NetworkId networkId);
+
+	// blend factor between the two ticks for entity. if entity was added in between, only the newer tick is used
+	// returns false if entity is not in either tick
+	bool blendFactor(const Rewind &rewind, int column, float &out_alpha);
+
+	static int Index(int tick, int column){return tick * PE_LAG_MAX_ENTITIES + column;}
+
+	// entity columns
+	Networkable::NetworkId m_entityIds[PE_LAG_MAX_ENTITIES];
+	NetGhostable *m_pGhostables[PE_LAG_MAX_ENTITIES]; // NULL = column not used
+	PrimitiveTypes::Int32 m_addedAtTick[PE_LAG_MAX_ENTITIES]; // first tick number entity is recorded in
+	int m_numColumns; // columns in use are all below this
+	std::vector<int> m_freeColumns;
+	std::vector<int> m_columnBySlot; // networkable slot index -> column or -1
+
+	// history, [tick][column]
+	std::vector<PrimitiveTypes::Float32> m_posX, m_posY, m_posZ;
+	std::vector<PrimitiveTypes::Float32> m_rotX, m_rotY, m_rotZ, m_rotW;
+	double m_tickTimes[PE_LAG_HISTORY_TICKS];
+	PrimitiveTypes::Int32 m_tickNumbers[PE_LAG_HISTORY_TICKS];
+
+	PrimitiveTypes::Int32 m_numTicksRecorded;
+};
+
+}; // namespace PE
+#endif
@@ -8,7 +8,9 @@
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -21,10 +23,15 @@ extern "C"
 
 #include "PrimeEngine/GameObjectModel/GameObjectManager.h"
 #include "PrimeEngine/Events/StandardEvents.h"
+#if !PE_NETWORKING_HEADLESS
 #include "PrimeEngine/Scene/DebugRenderer.h"
+#endif
 
 #include "PrimeEngine/Networking/StreamManager.h"
 #include "PrimeEngine/Networking/EventManager.h"
+#include "PrimeEngine/Networking/GhostManager.h"
+#include "PrimeEngine/Networking/MoveManager.h"
+#include "PrimeEngine/Networking/DatablockManager.h"
 
 #include <string>
 #include <sstream>
@@ -45,6 +52,12 @@ ServerNetworkManager::ServerNetworkManager(PE::GameContext &context, PE::MemoryA
 , m_clientConnections(context, arena, PE_SERVER_MAX_CONNECTIONS)
 {
 	m_state = ServerState_Uninitialized;
+	m_defaultPacketRate = PE_PACKET_DEFAULT_RATE;
+	m_defaultMaxPacketSize = PE_PACKET_MAX_DATAGRAM_SIZE;
+	m_connectionTimeout = PE_CONNECTION_TIMEOUT;
+
+	// never resized afterwards, stream managers of connected clients keep pointing into it
+	m_connectionState.resize(PE_SERVER_MAX_CONNECTIONS);
 }
 
 ServerNetworkManager::~ServerNetworkManager()
@@ -131,109 +144,375 @@ void ServerNetworkManager::createNetworkConnectionContext(t_socket sock,  int cl
 
 	pNetContext->getConnectionManager()->initializeConnected(sock);
 
-	addComponent(pNetContext->getConnectionManager()->getHandle());
-	addComponent(pNetContext->getStreamManager()->getHandle());
+	// per tick state of all clients lives side by side, see networkTick()
+	pNetContext->getStreamManager()->bindState(&m_connectionState, clientId);
+
+	// connection and stream managers are ticked by networkTick(), not as child components, so that they can be freed on disconnect
 }
 
+void ServerNetworkManager::destroyNetworkConnectionContext(PE::NetworkContext *pNetContext)
+{
+	pNetContext->getConnectionManager()->disconnect(); // closes socket
+
+	delete pNetContext->m_pConnectionManager;
+	delete pNetContext->m_pStreamManager;
+	delete pNetContext->m_pEventManager;
 
+	NetworkManager::destroyNetworkConnectionContext(pNetContext);
+}
 
-void ServerNetworkManager::do_UPDATE(Events::Event *pEvt)
+bool ServerNetworkManager::isClientConnected(int clientId)
 {
-	NetworkManager::do_UPDATE(pEvt);
+	return m_connectionTable.current().getContext(clientId) != NULL;
+}
+
+void ServerNetworkManager::disconnectClient(int clientId)
+{
+	if (!isClientConnected(clientId))
+		return;
+
+	PEINFO("PE: Disconnecting client %d\n", clientId);
+
+	m_interestManager.removeClient(clientId);
+	m_clientConnections[clientId].getConnectionManager()->disconnect(); // closes socket
+
+	// readers that still see client in older snapshot may use its managers, they are freed once those readers are done
+	PendingTeardown teardown;
+	teardown.m_clientId = clientId;
+	teardown.m_epoch = m_connectionTable.setContext(clientId, NULL);
+	m_pendingTeardowns.push_back(teardown);
+
+	m_clientData[clientId] = "";
+	m_clientOrigins[clientId].m_ip = 0;
+	m_clientOrigins[clientId].m_port = 0;
+
+	m_timers.cancel(m_timeoutTimers[clientId]);
+	m_timeoutTimers[clientId] = 0;
+}
+
+void ServerNetworkManager::reclaimConnections()
+{
+	m_connectionTable.reclaim();
+
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < m_pendingTeardowns.size(); ++i)
+	{
+		PendingTeardown &teardown = m_pendingTeardowns[i];
+		if (m_connectionTable.isSafe(teardown.m_epoch))
+		{
+			destroyNetworkConnectionContext(&m_clientConnections[teardown.m_clientId]);
+			m_freeClientIds.push_back(teardown.m_clientId); // slot can be reused only now
+		}
+		else
+			m_pendingTeardowns[kept++] = teardown;
+	}
+	m_pendingTeardowns.resize(kept);
+}
+
+void ServerNetworkManager::setNumWorkerThreads(int numThreads)
+{
+	m_workers.start(numThreads);
+}
+
+void ServerNetworkManager::setConnectionTimeout(double seconds)
+{
+	m_connectionTimeout = seconds;
+}
+
+void ServerNetworkManager::processTimer(const ServerTimingWheel::Expired &expired)
+{
+	switch (expired.m_type)
+	{
+	case Timer_ConnectionTimeout:
+	{
+		int clientId = expired.m_owner;
+		m_timeoutTimers[clientId] = 0;
+		if (!isClientConnected(clientId))
+			break;
+
+		// timer is not pushed back on every packet, it is re-armed here for the rest of the timeout
+		double idle = getNetworkTime() - m_connectionState.m_lastReceiveTime[clientId];
+		if (idle >= m_connectionTimeout)
+			disconnectClient(clientId);
+		else
+			m_timeoutTimers[clientId] = m_timers.schedule(getNetworkTime() + m_connectionTimeout - idle, Timer_ConnectionTimeout, clientId);
+		break;
+	}
+	default:
+		assert(!"Unknown server timer type");
+	}
+}
+
+
+
+void ServerNetworkManager::networkTick()
+{
+	// contexts of clients that disconnected earlier and are not visible to any reader anymore
+	reclaimConnections();
+
+	// sockets of all connections are read in parallel, each shard queues packets of its connections.
+	// table only changes on game thread, which is busy running shard 0, so workers use its snapshot without guard
+	const ServerConnectionTable::Snapshot *pSnapshot = &m_connectionTable.current();
+	m_workers.run([pSnapshot](int shard, int numShards)
+	{
+		for (unsigned int i = shard; i < pSnapshot->m_clientIds.size(); i += numShards)
+			pSnapshot->m_contexts[pSnapshot->m_clientIds[i]]->getConnectionManager()->readPackets();
+	});
+
+	// dispatch reaches game objects (events, moves) so it stays on game thread. connections whose socket failed are dropped.
+	// disconnect publishes new snapshot, old one stays valid until next reclaim
+	for (unsigned int i = 0; i < pSnapshot->m_clientIds.size(); ++i)
+	{
+		int clientId = pSnapshot->m_clientIds[i];
+		if (!isClientConnected(clientId))
+			continue; // dropped by handler of earlier packet
+
+		ConnectionManager *pConnectionManager = pSnapshot->m_contexts[clientId]->getConnectionManager();
+		pConnectionManager->dispatchPackets();
+		if (!pConnectionManager->connected())
+			disconnectClient(clientId);
+	}
+
+	// deadlines that passed. cost depends on number of expired timers, not number of connections
+	m_expiredTimers.clear();
+	m_timers.advance(getNetworkTime(), m_expiredTimers);
+	for (unsigned int i = 0; i < m_expiredTimers.size(); ++i)
+		processTimer(m_expiredTimers[i]);
+
+	// objects that moved to other cells enter/leave scope of clients
+	m_interestManager.updateObjects();
+
+	// where everything is this tick, for hit checks of clients that see the past. ticks are evenly spaced in history
+	m_lagCompensation.recordTick(getTickTime());
 
 	t_timeout timeoutRecv;
 	timeoutRecv.block = PE_SOCKET_RECEIVE_TIMEOUT;
 	timeoutRecv.total = -1.0;
 	timeoutRecv.start = 0;
 
-	size_t bytesRecv;
-	sockaddr_in messageOrigin;
-	socklen_t len = sizeof(messageOrigin);
+	// drain everything that arrived on listening socket since last tick
+	for (int iRequest = 0; iRequest < PE_SERVER_MAX_REQUESTS_PER_TICK; ++iRequest)
+	{
+		size_t bytesRecv = 0;
+		sockaddr_in messageOrigin;
+		socklen_t len = sizeof(messageOrigin);
 
-	char buff[1024];
-	int err2 = socket_recvfrom(&m_sock, buff, 1024, &bytesRecv, (SA*)&messageOrigin, &len, &timeoutRecv);
+		char buff[PE_HANDSHAKE_MAX_SIZE];
+		int err2 = socket_recvfrom(&m_sock, buff, PE_HANDSHAKE_MAX_SIZE, &bytesRecv, (SA*)&messageOrigin, &len, &timeoutRecv);
+		if (err2 != 0)
+			break; // nothing more pending
 
-	assert(bytesRecv <= 1024);
-	if (err2 == 0 ) {
+		processConnectionRequest(buff, (int)(bytesRecv), messageOrigin, len);
+	}
 
-		struct sockaddr_in* ipv4 = (struct sockaddr_in*)&messageOrigin;
-		char originAddress[INET_ADDRSTRLEN];
-		inet_ntop(AF_INET, &(ipv4->sin_addr), originAddress, INET_ADDRSTRLEN);
-		int originPort = ntohs(ipv4->sin_port);
+	// send budgets of all connections in one pass over state table. connections without a packet token this tick
+	// are not visited at all (their ghost priorities just don't grow this tick, which keeps their relative order)
+	pSnapshot = &m_connectionTable.current();
+	double now = getNetworkTime();
+	m_sendReadyClients.clear();
+	if (pSnapshot->m_clientIds.size())
+		m_connectionState.refillTokens(&pSnapshot->m_clientIds[0], (int)(pSnapshot->m_clientIds.size()), now);
+	for (unsigned int i = 0; i < pSnapshot->m_clientIds.size(); ++i)
+	{
+		if (m_connectionState.canSend(pSnapshot->m_clientIds[i]))
+			m_sendReadyClients.push_back(pSnapshot->m_clientIds[i]);
+	}
 
-		t_socket serverSock;
-		const char* err3 = inet_trycreate(&serverSock, SOCK_DGRAM);
-		const char* err4 = inet_trybind(&serverSock, "127.0.0.1", 0);
-		if (err3 == 0 && err4 == 0) {
+	// everything scheduled this tick goes out. packet assembly only reads game state, game thread waits until all shards are done
+	m_workers.run([this, pSnapshot](int shard, int numShards)
+	{
+		for (unsigned int i = shard; i < m_sendReadyClients.size(); i += numShards)
+			pSnapshot->m_contexts[m_sendReadyClients[i]]->getStreamManager()->sendNextPackets();
+	});
+}
 
+void ServerNetworkManager::sendHandshakeMessage(HandshakeMessage &msg, sockaddr_in &destination, socklen_t len)
+{
+	t_timeout timeoutSend;
+	timeoutSend.block = PE_SOCKET_RECEIVE_TIMEOUT;
+	timeoutSend.total = -1.0;
+	timeoutSend.start = 0;
 
-			t_timeout timeout;
-			timeout.block = 0;
-			timeout.total = -1.0;
-			timeout.start = 0;
+	char buff[PE_HANDSHAKE_MAX_SIZE];
+	int size = msg.write(buff);
 
-			struct sockaddr_in addr;
-			socklen_t len = sizeof(addr);
+	size_t step;
+	socket_sendto(&m_sock, buff, size, &step, (SA*)&destination, len, &timeoutSend);
+}
 
-			if (getsockname(serverSock, (struct sockaddr*)&addr, &len) == -1) {
-				perror("getsockname");
-				PEINFO("errno: %d\n", errno);
-				return;
-			}
+void ServerNetworkManager::processConnectionRequest(char *buff, int size, sockaddr_in &messageOrigin, socklen_t len)
+{
+	HandshakeMessage request;
+	if (!request.read(buff, size) || request.m_type != HandshakeMessage::Type_ConnectRequest)
+		return; // not for us, don't answer garbage
 
-			char ip[INET_ADDRSTRLEN];
-			inet_ntop(AF_INET, &(addr.sin_addr), ip, INET_ADDRSTRLEN);
-
-
-			const char* sockErr = inet_tryconnect(&serverSock, originAddress, originPort, &timeout);
-			if (sockErr == 0) {
-			
-				std::string clientConnectionMessage = "IP: " + std::string(ip) + " PORT: " + std::to_string(ntohs(addr.sin_port))+"\0";
-				clientConnectionMessage.push_back('\0');
-
-		
-				char sendBuff[512];
-				if (clientConnectionMessage.length() < 511) {
-					strcpy(sendBuff, clientConnectionMessage.c_str());
-				}
-				else {
-					PEINFO("Buffer overflow");
-				}
-
-				size_t step;
-				int send = socket_sendto(&m_sock, sendBuff,	512, &step, (SA*)&messageOrigin, len, &timeoutRecv);
-				if (send == 0) {
-					
-					PEINFO("SENT ACK");
-					m_connectionsMutex.lock();
-					m_clientConnections.add(NetworkContext());
-					int clientIndex = m_clientConnections.m_size-1;
-					std::string cliData = "Client " + std::to_string(clientIndex) + ": " + originAddress + " : " + std::to_string(originPort) + "\0";
-					m_clientData.push_back(cliData);
-					NetworkContext& netContext = m_clientConnections[clientIndex];
-
-					createNetworkConnectionContext(serverSock, clientIndex, &netContext);
-					m_connectionsMutex.unlock();
-
-					PE::Events::Event_SERVER_CLIENT_CONNECTION_ACK evt(*m_pContext);
-					evt.m_clientId = clientIndex;
-					netContext.getEventManager()->scheduleEvent(&evt, m_pContext->getGameObjectManager(), true);
-				}
+	if (request.m_version != PE_HANDSHAKE_VERSION)
+	{
+		HandshakeMessage reject(HandshakeMessage::Type_Reject);
+		reject.m_rejectReason = HandshakeMessage::Reject_Version;
+		sendHandshakeMessage(reject, messageOrigin, len);
+		return;
+	}
+
+	double now = getNetworkTime();
+	PrimitiveTypes::UInt32 originIp = messageOrigin.sin_addr.s_addr;
+	PrimitiveTypes::UInt16 originPort = messageOrigin.sin_port;
+
+	if (!request.m_cookie || !m_handshake.checkCookie(originIp, originPort, request.m_cookie, now))
+	{
+		// first contact or stale cookie: answer with cookie, allocate nothing
+		HandshakeMessage challenge(HandshakeMessage::Type_Challenge);
+		challenge.m_cookie = m_handshake.makeCookie(originIp, originPort, now);
+		sendHandshakeMessage(challenge, messageOrigin, len);
+		return;
+	}
+
+	// client repeated its cookie because our accept reply got lost. resend it, don't create second connection
+	for (unsigned int iClient = 0; iClient < m_clientOrigins.size(); ++iClient)
+	{
+		ClientOrigin &origin = m_clientOrigins[iClient];
+		if (origin.m_ip == originIp && origin.m_port == originPort)
+		{
+			sendHandshakeMessage(origin.m_accept, messageOrigin, len);
+			return;
+		}
+	}
+
+	if (!m_freeClientIds.size() && m_clientConnections.m_size >= PE_SERVER_MAX_CONNECTIONS)
+	{
+		HandshakeMessage reject(HandshakeMessage::Type_Reject);
+		reject.m_rejectReason = HandshakeMessage::Reject_ServerFull;
+		sendHandshakeMessage(reject, messageOrigin, len);
+		return;
+	}
+
+	// client may ask for a smaller send budget, never for more than server offers
+	int packetRate = m_defaultPacketRate;
+	int maxPacketSize = m_defaultMaxPacketSize;
+	if (request.m_packetRate > 0 && request.m_packetRate < packetRate)
+		packetRate = request.m_packetRate;
+	if (request.m_maxPacketSize > 0 && request.m_maxPacketSize < maxPacketSize)
+		maxPacketSize = request.m_maxPacketSize;
+	// accept advertises what stream manager will actually use, it doesn't go below minimum
+	if (packetRate < PE_PACKET_MIN_RATE)
+		packetRate = PE_PACKET_MIN_RATE;
+	if (maxPacketSize < PE_PACKET_MIN_SIZE)
+		maxPacketSize = PE_PACKET_MIN_SIZE;
+
+	struct sockaddr_in* ipv4 = (struct sockaddr_in*)&messageOrigin;
+	char originAddress[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &(ipv4->sin_addr), originAddress, INET_ADDRSTRLEN);
+	int originPortHost = ntohs(ipv4->sin_port);
+
+	t_socket serverSock = SOCKET_INVALID;
+	const char* err3 = inet_trycreate(&serverSock, SOCK_DGRAM);
+	const char* err4 = err3 ? err3 : inet_trybind(&serverSock, "127.0.0.1", 0);
+	if (err3 == 0 && err4 == 0) {
+
+
+		t_timeout timeout;
+		timeout.block = 0;
+		timeout.total = -1.0;
+		timeout.start = 0;
+
+		struct sockaddr_in addr;
+		socklen_t addrLen = sizeof(addr);
+
+		if (getsockname(serverSock, (struct sockaddr*)&addr, &addrLen) == -1) {
+			PEINFO("PE: Warning: Could not get address of client socket: %s\n", socket_strerror(errno));
+			socket_destroy(&serverSock);
+
+			HandshakeMessage reject(HandshakeMessage::Type_Reject);
+			reject.m_rejectReason = HandshakeMessage::Reject_Failed;
+			sendHandshakeMessage(reject, messageOrigin, len);
+			return;
+		}
+
+		const char* sockErr = inet_tryconnect(&serverSock, originAddress, originPortHost, &timeout);
+		if (sockErr == 0) {
+
+			// slots of disconnected clients are reused
+			int clientIndex = m_freeClientIds.size() ? m_freeClientIds.back() : (int)(m_clientConnections.m_size);
+
+			ClientOrigin origin;
+			origin.m_ip = originIp;
+			origin.m_port = originPort;
+			origin.m_accept.m_type = HandshakeMessage::Type_Accept;
+			origin.m_accept.m_ip = addr.sin_addr.s_addr;
+			origin.m_accept.m_port = addr.sin_port;
+			origin.m_accept.m_clientId = clientIndex;
+			origin.m_accept.m_capabilities = request.m_capabilities & PE_SERVER_CAPABILITIES;
+			origin.m_accept.m_packetRate = (PrimitiveTypes::Int16)(packetRate);
+			origin.m_accept.m_maxPacketSize = (PrimitiveTypes::Int16)(maxPacketSize);
+
+			sendHandshakeMessage(origin.m_accept, messageOrigin, len);
+
+			PEINFO("SENT ACK");
+			std::string cliData = "Client " + std::to_string(clientIndex) + ": " + originAddress + " : " + std::to_string(originPortHost) + "\0";
+			if (m_freeClientIds.size())
+			{
+				m_freeClientIds.pop_back();
+				m_clientData[clientIndex] = cliData;
+				m_clientOrigins[clientIndex] = origin;
+				m_timeoutTimers[clientIndex] = 0;
 			}
-			else {
-				PEINFO("FAILED TO CONNECT");
+			else
+			{
+				m_clientConnections.add(NetworkContext());
+				m_clientData.push_back(cliData);
+				m_clientOrigins.push_back(origin);
+				m_timeoutTimers.push_back(0);
 			}
+			NetworkContext& netContext = m_clientConnections[clientIndex];
+
+			createNetworkConnectionContext(serverSock, clientIndex, &netContext);
+			netContext.getStreamManager()->setPacketRate(packetRate);
+			netContext.getStreamManager()->setMaxPacketSize(maxPacketSize);
+			netContext.getStreamManager()->enableMtuProbing((origin.m_accept.m_capabilities & PE_HANDSHAKE_CAP_MTU_PROBING) != 0);
+			m_interestManager.addClient(clientIndex, netContext.getGhostManager());
+			for (unsigned int iGhost = 0; iGhost < m_globalGhosts.size(); ++iGhost)
+				netContext.getGhostManager()->ghostObject(m_globalGhosts[iGhost].m_networkId, m_globalGhosts[iGhost].m_pGhostable);
+			m_timeoutTimers[clientIndex] = m_timers.schedule(getNetworkTime() + m_connectionTimeout, Timer_ConnectionTimeout, clientIndex);
+
+			// datablock phase: static data streams in parallel with regular traffic
+			for (unsigned int iDatablock = 0; iDatablock < m_datablocks.size(); ++iDatablock)
+				netContext.getDatablockManager()->queueDatablock(m_datablocks[iDatablock].m_id, m_datablocks[iDatablock].m_pData, m_datablocks[iDatablock].m_size);
+
+			// readers see new client only once it is fully set up
+			m_connectionTable.setContext(clientIndex, &netContext);
+
+			PE::Events::Event_SERVER_CLIENT_CONNECTION_ACK evt(*m_pContext);
+			evt.m_clientId = clientIndex;
+			netContext.getEventManager()->scheduleEvent(&evt, m_pContext->getGameObjectManager(), true);
+		}
+		else {
+			PEINFO("FAILED TO CONNECT");
+			socket_destroy(&serverSock);
+
+			HandshakeMessage reject(HandshakeMessage::Type_Reject);
+			reject.m_rejectReason = HandshakeMessage::Reject_Failed;
+			sendHandshakeMessage(reject, messageOrigin, len);
 		}
 	}
-	//else {
-	//	//PEINFO("No conn req");
-	//}
+	else {
+		PEINFO("PE: Warning: Could not create client socket: %s\n", err3 ? err3 : err4);
+		socket_destroy(&serverSock);
 
+		HandshakeMessage reject(HandshakeMessage::Type_Reject);
+		reject.m_rejectReason = HandshakeMessage::Reject_Failed;
+		sendHandshakeMessage(reject, messageOrigin, len);
+	}
 }
 
 void ServerNetworkManager::debugRender(int &threadOwnershipMask, float xoffset /* = 0*/, float yoffset /* = 0*/)
 {
-	sprintf(PEString::s_buf, "Server: Port %d %d Connections", m_serverPort, m_clientConnections.m_size);
+#if !PE_NETWORKING_HEADLESS
+	// game thread only: guard keeps contexts alive, but event managers are read without locks
+	// (same thread that calls networkTick(), not render thread)
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	const ServerConnectionTable::Snapshot &snapshot = guard.snapshot();
+
+	sprintf(PEString::s_buf, "Server: Port %d %d Connections", m_serverPort, (int)(snapshot.m_clientIds.size()));
 	DebugRenderer::Instance()->createTextMesh(
 		PEString::s_buf, true, false, false, false, 0,
 		Vector3(xoffset, yoffset, 0), 1.0f, threadOwnershipMask);
@@ -242,9 +521,7 @@ void ServerNetworkManager::debugRender(int &threadOwnershipMask, float xoffset /
 	float dx = 0.01;
 	float evtManagerDy = 0.15f;
 	// debug render all networking contexts
-	m_connectionsMutex.lock();
-
-	if (m_clientConnections.m_size == 1) {
+	if (snapshot.m_clientIds.size() == 1) {
 		sprintf(PEString::s_buf,"Please wait for the other client to connect.");
 		DebugRenderer::Instance()->createTextMesh(
 			PEString::s_buf, true, false, false, false, 0,
@@ -252,8 +529,10 @@ void ServerNetworkManager::debugRender(int &threadOwnershipMask, float xoffset /
 
 	}
 
-	for (unsigned int i = 0; i < m_clientConnections.m_size; ++i)
+	for (unsigned int iClient = 0; iClient < snapshot.m_clientIds.size(); ++iClient)
 	{
+		int i = snapshot.m_clientIds[iClient];
+
 		sprintf(PEString::s_buf, "Connection[%d]:", i);
 	
 		DebugRenderer::Instance()->createTextMesh(
@@ -265,26 +544,188 @@ void ServerNetworkManager::debugRender(int &threadOwnershipMask, float xoffset /
 			PEString::s_buf, true, false, false, false, 0,
 			Vector3(xoffset, 1- (yoffset + dy + evtManagerDy * i), 0), 1.0f, threadOwnershipMask);*/
 
-		NetworkContext &netContext = m_clientConnections[i];
+		NetworkContext &netContext = *snapshot.m_contexts[i];
 		netContext.getEventManager()->debugRender(threadOwnershipMask, xoffset + dx, yoffset + dy * 2.0f + evtManagerDy * i);
 	}
-	m_connectionsMutex.unlock();
+#endif
 }
 
 void ServerNetworkManager::scheduleEventToAllExcept(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, int exceptClient)
 {
-	for (unsigned int i = 0; i < m_clientConnections.m_size; ++i)
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	const ServerConnectionTable::Snapshot &snapshot = guard.snapshot();
+
+	for (unsigned int i = 0; i < snapshot.m_clientIds.size(); ++i)
 	{
-		if ((int)(i) == exceptClient)
+		if (snapshot.m_clientIds[i] == exceptClient)
 			continue;
 
-		NetworkContext &netContext = m_clientConnections[i];
+		NetworkContext &netContext = *snapshot.m_contexts[snapshot.m_clientIds[i]];
 		netContext.getEventManager()->scheduleEvent(pNetworkable, pNetworkableTarget, true);
 	}
 }
 
+void ServerNetworkManager::scheduleEventToRelevant(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, const Vector3 &position, float radius, bool guaranteed /* = false*/)
+{
+	scheduleEventToRelevantExcept(pNetworkable, pNetworkableTarget, position, radius, -1, guaranteed);
+}
+
+void ServerNetworkManager::scheduleEventToRelevantExcept(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, const Vector3 &position, float radius, int exceptClient, bool guaranteed /* = false*/)
+{
+	m_relevantClients.clear();
+	m_interestManager.findClientsInRadius(position, radius, m_relevantClients);
+
+	if (!m_relevantClients.size())
+		return; // nobody is close enough, don't even serialize
+
+	EventTransmissionData packed;
+	{
+		// one packing is shared by all recipients, so strings go in full (no connection's table)
+		StreamManager::ActiveStringTableScope stringTableScope(NULL);
+		EventManager::PackEvent(pNetworkable, pNetworkableTarget, packed);
+	}
+
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	for (unsigned int i = 0; i < m_relevantClients.size(); ++i)
+	{
+		NetworkContext *pNetContext = guard.snapshot().getContext(m_relevantClients[i]);
+		if (m_relevantClients[i] == exceptClient || !pNetContext)
+			continue;
+
+		pNetContext->getEventManager()->schedulePackedEvent(packed, guaranteed);
+	}
+}
+
+void ServerNetworkManager::ghostObjectToAll(PE::Networkable *pNetworkable, PE::NetGhostable *pGhostable)
+{
+	setNetworkableGhostable(pNetworkable->m_networkId, pGhostable);
+
+	GlobalGhost ghost;
+	ghost.m_networkId = pNetworkable->m_networkId;
+	ghost.m_pGhostable = pGhostable;
+	m_globalGhosts.push_back(ghost);
 
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	const ServerConnectionTable::Snapshot &snapshot = guard.snapshot();
 
+	for (unsigned int i = 0; i < snapshot.m_clientIds.size(); ++i)
+	{
+		NetworkContext &netContext = *snapshot.m_contexts[snapshot.m_clientIds[i]];
+		netContext.getGhostManager()->ghostObject(pNetworkable->m_networkId, pGhostable);
+	}
+}
+
+void ServerNetworkManager::unghostObjectFromAll(PE::Networkable *pNetworkable)
+{
+	for (unsigned int i = 0; i < m_globalGhosts.size(); ++i)
+	{
+		if (m_globalGhosts[i].m_networkId == pNetworkable->m_networkId)
+		{
+			m_globalGhosts[i] = m_globalGhosts.back();
+			m_globalGhosts.pop_back();
+			break;
+		}
+	}
+
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	const ServerConnectionTable::Snapshot &snapshot = guard.snapshot();
+
+	for (unsigned int i = 0; i < snapshot.m_clientIds.size(); ++i)
+	{
+		NetworkContext &netContext = *snapshot.m_contexts[snapshot.m_clientIds[i]];
+		netContext.getGhostManager()->unghostObject(pNetworkable->m_networkId);
+	}
+}
+
+void ServerNetworkManager::addScopedObject(PE::Networkable *pNetworkable, PE::NetGhostable *pGhostable)
+{
+	setNetworkableGhostable(pNetworkable->m_networkId, pGhostable);
+	m_interestManager.addObject(pNetworkable->m_networkId, pGhostable);
+}
+
+void ServerNetworkManager::removeScopedObject(PE::Networkable *pNetworkable)
+{
+	m_interestManager.removeObject(pNetworkable->m_networkId);
+}
+
+void ServerNetworkManager::setClientViewpoint(int clientId, const GhostViewpoint &viewpoint)
+{
+	if (!isClientConnected(clientId))
+		return; // late update of client that is gone
+
+	m_interestManager.moveClient(clientId, viewpoint.m_position);
+
+	// also used to prioritize updates of objects in scope
+	m_clientConnections[clientId].getGhostManager()->setViewpoint(viewpoint);
+}
+
+void ServerNetworkManager::addLagCompensatedObject(PE::Networkable *pNetworkable, PE::NetGhostable *pGhostable)
+{
+	m_lagCompensation.addEntity(pNetworkable->m_networkId, pGhostable);
+}
+
+void ServerNetworkManager::removeLagCompensatedObject(PE::Networkable *pNetworkable)
+{
+	m_lagCompensation.removeEntity(pNetworkable->m_networkId);
+}
+
+double ServerNetworkManager::getClientViewTime(int clientId)
+{
+	if (!isClientConnected(clientId))
+		return getNetworkTime();
+
+	NetworkContext &netContext = m_clientConnections[clientId];
+	return ServerLagCompensation::ComputeViewTime(getNetworkTime(),
+		netContext.getStreamManager()->getRtt(),
+		netContext.getMoveManager()->getRemoteInterpolationDelay());
+}
+
+bool ServerNetworkManager::rewindToClientView(int clientId, ServerLagCompensation::Rewind &out_rewind)
+{
+	return m_lagCompensation.findRewind(getClientViewTime(clientId), out_rewind);
+}
+
+void ServerNetworkManager::addDatablock(PrimitiveTypes::Int32 datablockId, const char *pData, int size)
+{
+	ServerDatablock datablock;
+	datablock.m_id = datablockId;
+	datablock.m_pData = pData;
+	datablock.m_size = size;
+	m_datablocks.push_back(datablock);
+}
+
+void ServerNetworkManager::setDefaultPacketRate(int packetsPerSecond, int maxPacketSize)
+{
+	m_defaultPacketRate = packetsPerSecond;
+	m_defaultMaxPacketSize = maxPacketSize;
+}
+
+void ServerNetworkManager::setClientPacketRate(int clientId, int packetsPerSecond, int maxPacketSize)
+{
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	if (NetworkContext *pNetContext = guard.snapshot().getContext(clientId))
+	{
+		StreamManager *pStreamManager = pNetContext->getStreamManager();
+		pStreamManager->setPacketRate(packetsPerSecond);
+		pStreamManager->setMaxPacketSize(maxPacketSize);
+	}
+}
+
+void ServerNetworkManager::setGhostMaskBits(PE::Networkable *pNetworkable, PrimitiveTypes::UInt32 mask)
+{
+	ServerConnectionTable::ReadGuard guard(m_connectionTable);
+	const ServerConnectionTable::Snapshot &snapshot = guard.snapshot();
+
+	for (unsigned int i = 0; i < snapshot.m_clientIds.size(); ++i)
+	{
+		NetworkContext &netContext = *snapshot.m_contexts[snapshot.m_clientIds[i]];
+		netContext.getGhostManager()->setMaskBits(pNetworkable->m_networkId, mask);
+	}
+}
+
+
+
+#if !PE_NETWORKING_HEADLESS
 void ConnectionManager::SetLuaFunctions(PE::Components::LuaEnvironment *pLuaEnv, lua_State *luaVM)
 {
 	
@@ -318,7 +759,7 @@ int ConnectionManager::l_clientConnectToUDPServer(lua_State *luaVM)
 
 	return 0; // no return values
 }
-
+#endif
 
 }; // namespace Components
 }; // namespace PE
@@ -16,6 +16,17 @@
 // Sibling/Children includes
 
 #include "PrimeEngine/Networking/NetworkManager.h"
+#include "ServerInterestManager.h"
+#include "ServerLagCompensation.h"
+#include "ServerHandshake.h"
+#include "ServerTimingWheel.h"
+#include "ServerWorkerPool.h"
+#include "ServerConnectionTable.h"
+#include "PrimeEngine/Networking/HandshakeMessage.h"
+#include "PrimeEngine/Networking/ConnectionStateTable.h"
+
+// capabilities server agrees to when client asks for them
+#define PE_SERVER_CAPABILITIES (PE_HANDSHAKE_CAP_MTU_PROBING)
 
 namespace PE {
 
@@ -44,19 +55,87 @@ struct ServerNetworkManager : public NetworkManager
 	void serverOpenTCPSocket();
 
 	virtual void createNetworkConnectionContext(t_socket sock, int clientId, PE::NetworkContext *pNetContext);
+	virtual void destroyNetworkConnectionContext(PE::NetworkContext *pNetContext);
 
+	// false for ids that were never used and for slots of disconnected clients. game thread only, other threads use getConnectionTable()
+	bool isClientConnected(int clientId);
+
+	// closes socket and removes client from connection table. done automatically on timeout or socket error
+	// context is freed and client id put on free list by reclaimConnections() once no reader can see it
+	void disconnectClient(int clientId);
+	void reclaimConnections();
+
+	ServerConnectionTable &getConnectionTable(){return m_connectionTable;}
+
+	// seconds without any packet from client after which it is disconnected
+	void setConnectionTimeout(double seconds);
+
+	// connections are split into numThreads + 1 shards; socket reads and packet assembly of shards run in parallel
+	// dispatch of received packets and everything else stays on game thread. 0 (default) = single threaded
+	void setNumWorkerThreads(int numThreads);
+
+	// per connection deadlines. timer owner is client id
+	enum ETimerType
+	{
+		Timer_ConnectionTimeout = 0,
+		Timer_Count
+	};
+	ServerTimingWheel &getTimingWheel(){return m_timers;}
+	void processTimer(const ServerTimingWheel::Expired &expired);
+
+	// call on game thread (the one running networkTick()), it reads internals of connection managers
 	void debugRender(int &threadOwnershipMask, float xoffset = 0, float yoffset = 0);
 
 	// forward to event manager
 	void scheduleEventToAllExcept(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, int exceptClient);
 
+	// schedules event only to clients whose viewpoint is within radius of position (local effects: sparks, horns, pickups)
+	// recipients are found through interest management grid. event is serialized once for all recipients
+	void scheduleEventToRelevant(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, const Vector3 &position, float radius, bool guaranteed = false);
+	void scheduleEventToRelevantExcept(PE::Networkable *pNetworkable, PE::Networkable *pNetworkableTarget, const Vector3 &position, float radius, int exceptClient, bool guaranteed = false);
+
+	// forward to ghost managers. objects ghosted to all are remembered and ghosted to clients that connect later too
+	void ghostObjectToAll(PE::Networkable *pNetworkable, PE::NetGhostable *pGhostable);
+	void unghostObjectFromAll(PE::Networkable *pNetworkable);
+	void setGhostMaskBits(PE::Networkable *pNetworkable, PrimitiveTypes::UInt32 mask);
+
+	// interest management: object is ghosted only to clients whose viewpoint is near it
+	void addScopedObject(PE::Networkable *pNetworkable, PE::NetGhostable *pGhostable);
+	void removeScopedObject(PE::Networkable *pNetworkable);
+	void setClientViewpoint(int clientId, const GhostViewpoint &viewpoint);
+
+	// lag compensation: transforms of object are recorded every tick so that hit checks can be done against the past
+	void addLagCompensatedObject(PE::Networkable *pNetworkable, PE::NetGhostable *pGhostable);
+	void removeLagCompensatedObject(PE::Networkable *pNetworkable);
+
+	// network time the client was looking at, from its round trip time and reported interpolation delay
+	double getClientViewTime(int clientId);
+
+	// finds history ticks around client's view time. use with ServerLagCompensation::getPosition()/getOrientation()
+	bool rewindToClientView(int clientId, ServerLagCompensation::Rewind &out_rewind);
+	ServerLagCompensation &getLagCompensation(){return m_lagCompensation;}
+
+	// static data every client gets streamed right after it connects (see DatablockManager)
+	// data is not copied and has to stay valid while server runs
+	void addDatablock(PrimitiveTypes::Int32 datablockId, const char *pData, int size);
+
+	// send budget offered to connecting clients. client can ask for less with m_packetRate/m_maxPacketSize of its HandshakeMessage connect request
+	// (never below PE_PACKET_MIN_RATE/PE_PACKET_MIN_SIZE)
+	void setDefaultPacketRate(int packetsPerSecond, int maxPacketSize);
+
+	// changes send budget of one connected client at runtime
+	void setClientPacketRate(int clientId, int packetsPerSecond, int maxPacketSize);
+
 
 	// Component ------------------------------------------------------------
 	virtual void addDefaultComponents();
 
-	// Individual events -------------------------------------------------------
-	PE_DECLARE_IMPLEMENT_EVENT_HANDLER_WRAPPER(do_UPDATE);
-	virtual void do_UPDATE(Events::Event *pEvt);
+	// receive, timers, interest, handshakes and send of all connections. runs at tick rate, see NetworkManager::setTickRate()
+	virtual void networkTick();
+
+	// handles one datagram received on listening socket: hands out cookie or accepts client that echoed valid one
+	void processConnectionRequest(char *buff, int size, sockaddr_in &messageOrigin, socklen_t len);
+	void sendHandshakeMessage(HandshakeMessage &msg, sockaddr_in &destination, socklen_t len);
 
 	// Loading -----------------------------------------------------------------
 
@@ -81,7 +160,64 @@ struct ServerNetworkManager : public NetworkManager
 	Array<NetworkContext> m_clientConnections;
 	//Array<char[40]> m_clientData[10];
 	std::vector<std::string> m_clientData;
-	Threading::Mutex m_connectionsMutex;
+
+	// where each client connected from (network byte order) and the accept reply it got, indexed by client id
+	struct ClientOrigin
+	{
+		PrimitiveTypes::UInt32 m_ip;
+		PrimitiveTypes::UInt16 m_port;
+		HandshakeMessage m_accept;
+	};
+	std::vector<ClientOrigin> m_clientOrigins;
+
+	ServerHandshake m_handshake;
+
+	// connected clients, read without locks. m_clientConnections slots stay allocated until teardown is reclaimed
+	ServerConnectionTable m_connectionTable;
+
+	// disconnected clients whose contexts may still be in use by readers of an older snapshot
+	struct PendingTeardown
+	{
+		int m_clientId;
+		unsigned long long m_epoch;
+	};
+	std::vector<PendingTeardown> m_pendingTeardowns;
+
+	// sequence/ack state, send budgets and send/receive times of all clients, indexed by client id
+	ConnectionStateTable m_connectionState;
+	std::vector<int> m_sendReadyClients; // kept to avoid reallocation
+
+	ServerInterestManager m_interestManager;
+	std::vector<int> m_relevantClients; // kept to avoid reallocation
+
+	ServerLagCompensation m_lagCompensation;
+
+	struct ServerDatablock
+	{
+		PrimitiveTypes::Int32 m_id;
+		const char *m_pData;
+		int m_size;
+	};
+	std::vector<ServerDatablock> m_datablocks;
+
+	// objects ghosted to every client, see ghostObjectToAll()
+	struct GlobalGhost
+	{
+		Networkable::NetworkId m_networkId;
+		PE::NetGhostable *m_pGhostable;
+	};
+	std::vector<GlobalGhost> m_globalGhosts;
+
+	int m_defaultPacketRate;
+	int m_defaultMaxPacketSize;
+
+	std::vector<int> m_freeClientIds; // slots of disconnected clients, reused before array grows
+	double m_connectionTimeout;
+
+	ServerTimingWheel m_timers;
+	ServerWorkerPool m_workers;
+	std::vector<ServerTimingWheel::Expired> m_expiredTimers; // kept to avoid reallocation
+	std::vector<ServerTimingWheel::TimerId> m_timeoutTimers; // indexed by client id, 0 = none
 };
 }; // namespace Components
 }; // namespace PE
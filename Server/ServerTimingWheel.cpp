@@ -0,0 +1,162 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ServerTimingWheel.h"
+
+// Outer-Engine includes
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+ServerTimingWheel::ServerTimingWheel()
+: m_currentTick(0)
+, m_numTimers(0)
+{
+	for (int i = 0; i < PE_TIMING_WHEEL_LEVELS * PE_TIMING_WHEEL_SLOTS; ++i)
+		m_slots[i] = -1;
+
+	Timer unused = {0, 0, 0, -1, -1, -1, 0};
+	m_timers.push_back(unused);
+}
+
+ServerTimingWheel::TimerId ServerTimingWheel::schedule(double deadline, int type, int owner)
+{
+	int index;
+	if (m_freeTimers.size())
+	{
+		index = m_freeTimers.back();
+		m_freeTimers.pop_back();
+	}
+	else
+	{
+		index = (int)(m_timers.size());
+		PEASSERT(index < (1 << PE_TIMER_ID_INDEX_BITS), "Ran out of timer slots");
+		Timer unused = {0, 0, 0, -1, -1, -1, 0};
+		m_timers.push_back(unused);
+	}
+
+	Timer &timer = m_timers[index];
+	timer.m_type = type;
+	timer.m_owner = owner;
+
+	// deadline in the past fires on next advance
+	unsigned long long tick = DeadlineToTick(deadline);
+	timer.m_expireTick = tick > m_currentTick ? tick : m_currentTick + 1;
+
+	insert(index);
+	++m_numTimers;
+
+	return (timer.m_generation << PE_TIMER_ID_INDEX_BITS) | (PrimitiveTypes::UInt32)(index);
+}
+
+void ServerTimingWheel::cancel(TimerId timerId)
+{
+	int index = (int)(timerId & ((1 << PE_TIMER_ID_INDEX_BITS) - 1));
+	PrimitiveTypes::UInt32 generation = timerId >> PE_TIMER_ID_INDEX_BITS;
+
+	if (!index || index >= (int)(m_timers.size()))
+		return;
+
+	Timer &timer = m_timers[index];
+	if (timer.m_slot < 0 || timer.m_generation != generation)
+		return; // stale id
+
+	unlink(index);
+	timer.m_generation = (timer.m_generation + 1) & ((1 << PE_TIMER_ID_GENERATION_BITS) - 1);
+	m_freeTimers.push_back(index);
+	--m_numTimers;
+}
+
+void ServerTimingWheel::insert(int index)
+{
+	Timer &timer = m_timers[index];
+
+	// lowest level at which deadline and current tick are in the same turn of the level above
+	int level = 0;
+	while (level < PE_TIMING_WHEEL_LEVELS - 1
+		&& (timer.m_expireTick >> ((level + 1) * PE_TIMING_WHEEL_SLOT_BITS)) != (m_currentTick >> ((level + 1) * PE_TIMING_WHEEL_SLOT_BITS)))
+	{
+		++level;
+	}
+
+	int slot = level * PE_TIMING_WHEEL_SLOTS + (int)((timer.m_expireTick >> (level * PE_TIMING_WHEEL_SLOT_BITS)) & (PE_TIMING_WHEEL_SLOTS - 1));
+
+	timer.m_slot = slot;
+	timer.m_prev = -1;
+	timer.m_next = m_slots[slot];
+	if (timer.m_next >= 0)
+		m_timers[timer.m_next].m_prev = index;
+	m_slots[slot] = index;
+}
+
+void ServerTimingWheel::unlink(int index)
+{
+	Timer &timer = m_timers[index];
+	assert(timer.m_slot >= 0);
+
+	if (timer.m_prev >= 0)
+		m_timers[timer.m_prev].m_next = timer.m_next;
+	else
+		m_slots[timer.m_slot] = timer.m_next;
+
+	if (timer.m_next >= 0)
+		m_timers[timer.m_next].m_prev = timer.m_prev;
+
+	timer.m_slot = -1;
+}
+
+void ServerTimingWheel::cascade(int level)
+{
+	int slot = level * PE_TIMING_WHEEL_SLOTS + (int)((m_currentTick >> (level * PE_TIMING_WHEEL_SLOT_BITS)) & (PE_TIMING_WHEEL_SLOTS - 1));
+
+	// detach whole slot first, timers too far in the future go back into the same slot
+	m_detached.clear();
+	for (int index = m_slots[slot]; index >= 0; index = m_timers[index].m_next)
+		m_detached.push_back(index);
+	m_slots[slot] = -1;
+
+	for (unsigned int i = 0; i < m_detached.size(); ++i)
+		insert(m_detached[i]);
+}
+
+void ServerTimingWheel::advance(double now, std::vector<Expired> &out_expired)
+{
+	unsigned long long targetTick = TimeToTick(now);
+
+	while (m_currentTick < targetTick)
+	{
+		++m_currentTick;
+
+		// higher levels first, what comes down may land in slots cascaded next
+		for (int level = PE_TIMING_WHEEL_LEVELS - 1; level > 0; --level)
+		{
+			if ((m_currentTick & ((1ULL << (level * PE_TIMING_WHEEL_SLOT_BITS)) - 1)) == 0)
+				cascade(level);
+		}
+
+		int slot = (int)(m_currentTick & (PE_TIMING_WHEEL_SLOTS - 1));
+		while (m_slots[slot] >= 0)
+		{
+			int index = m_slots[slot];
+			Timer &timer = m_timers[index];
+			assert(timer.m_expireTick <= m_currentTick);
+
+			unlink(index);
+
+			Expired expired;
+			expired.m_type = timer.m_type;
+			expired.m_owner = timer.m_owner;
+			out_expired.push_back(expired);
+
+			timer.m_generation = (timer.m_generation + 1) & ((1 << PE_TIMER_ID_GENERATION_BITS) - 1);
+			m_freeTimers.push_back(index);
+			--m_numTimers;
+		}
+	}
+}
+
+}; // namespace PE
@@ -0,0 +1,91 @@
+#ifndef __PrimeEngineServerTimingWheel_H__
+#define __PrimeEngineServerTimingWheel_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <math.h>
+#include <vector>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+// seconds per tick of lowest wheel level
+#define PE_TIMING_WHEEL_RESOLUTION 0.01
+
+// each level has 2^bits slots. 4 levels of 64 slots cover 2^24 ticks (~46 hours). later deadlines still fire on time,
+// they go back into their top level slot on every turn of the top level until their turn comes
+#define PE_TIMING_WHEEL_SLOT_BITS 6
+#define PE_TIMING_WHEEL_SLOTS (1 << PE_TIMING_WHEEL_SLOT_BITS)
+#define PE_TIMING_WHEEL_LEVELS 4
+
+// timer ids are (index, generation) pairs like network ids, so that cancelling a timer that already fired is harmless
+#define PE_TIMER_ID_INDEX_BITS 20
+#define PE_TIMER_ID_GENERATION_BITS 12
+
+namespace PE {
+
+// Hierarchical timing wheel for connection deadlines (timeouts, keepalives, handshake expiry...).
+// Level 0 has one slot per tick, every higher level has one slot per full turn of the level below.
+// A timer sits in the lowest level whose turn still contains its deadline; when time reaches a slot of a
+// higher level its timers cascade to lower levels. Insert and cancel are O(1) (intrusive lists in a pool),
+// advance costs O(levels) per tick plus the timers that expire or cascade. Times are network time in seconds.
+struct ServerTimingWheel
+{
+	typedef PrimitiveTypes::UInt32 TimerId; // 0 = no timer
+
+	// what expired. meaning of type and owner is up to user (e.g. timer kind and client id)
+	struct Expired
+	{
+		int m_type;
+		int m_owner;
+	};
+
+	ServerTimingWheel();
+
+	TimerId schedule(double deadline, int type, int owner);
+
+	/// does nothing if timer already fired or was cancelled
+	void cancel(TimerId timerId);
+
+	/// moves wheel to time now, appends expired timers in order of deadline tick
+	void advance(double now, std::vector<Expired> &out_expired);
+
+	int getNumTimers(){return m_numTimers;}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	struct Timer
+	{
+		unsigned long long m_expireTick;
+		int m_type;
+		int m_owner;
+		int m_slot; // -1 = timer is free
+		int m_prev; // -1 = first in slot
+		int m_next; // -1 = last in slot
+		PrimitiveTypes::UInt32 m_generation;
+	};
+
+	void insert(int index);
+	void unlink(int index);
+	void cascade(int level);
+
+	static unsigned long long TimeToTick(double time){return (unsigned long long)(time / PE_TIMING_WHEEL_RESOLUTION);}
+	// rounds up, timers never fire before their deadline
+	static unsigned long long DeadlineToTick(double time){return (unsigned long long)(ceil(time / PE_TIMING_WHEEL_RESOLUTION));}
+
+	std::vector<Timer> m_timers; // index 0 is unused so that id 0 is never valid
+	std::vector<int> m_freeTimers;
+	int m_slots[PE_TIMING_WHEEL_LEVELS * PE_TIMING_WHEEL_SLOTS]; // first timer of each slot, -1 = empty
+	unsigned long long m_currentTick;
+	int m_numTimers;
+	std::vector<int> m_detached; // kept to avoid reallocation
+};
+
+}; // namespace PE
+#endif
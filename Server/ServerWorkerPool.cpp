@@ -0,0 +1,105 @@
+#define NOMINMAX
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+#include "ServerWorkerPool.h"
+
+// Outer-Engine includes
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+ServerWorkerPool::ServerWorkerPool()
+: m_pFunction(NULL)
+, m_runIndex(0)
+, m_numShards(1)
+, m_numPending(0)
+, m_quit(false)
+{}
+
+ServerWorkerPool::~ServerWorkerPool()
+{
+	stop();
+}
+
+void ServerWorkerPool::start(int numWorkers)
+{
+	stop();
+
+	m_quit = false;
+	for (int i = 0; i < numWorkers; ++i)
+		m_threads.push_back(std::thread(&ServerWorkerPool::workerLoop, this, i + 1, m_runIndex));
+}
+
+void ServerWorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_workAvailable.notify_all();
+
+	for (unsigned int i = 0; i < m_threads.size(); ++i)
+		m_threads[i].join();
+	m_threads.clear();
+}
+
+void ServerWorkerPool::run(const ShardFunction &function)
+{
+	int numShards = getNumShards();
+	if (numShards == 1)
+	{
+		function(0, 1);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pFunction = &function;
+		m_numShards = numShards;
+		m_numPending = numShards - 1;
+		++m_runIndex;
+	}
+	m_workAvailable.notify_all();
+
+	function(0, numShards);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_numPending)
+		m_workDone.wait(lock);
+	m_pFunction = NULL;
+}
+
+void ServerWorkerPool::workerLoop(int shard, unsigned int lastRun)
+{
+	while (true)
+	{
+		const ShardFunction *pFunction;
+		int numShards;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_quit && m_runIndex == lastRun)
+				m_workAvailable.wait(lock);
+
+			if (m_quit)
+				return;
+
+			lastRun = m_runIndex;
+			pFunction = m_pFunction;
+			numShards = m_numShards;
+		}
+
+		(*pFunction)(shard, numShards);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_numPending;
+		}
+		m_workDone.notify_one();
+	}
+}
+
+}; // namespace PE
@@ -0,0 +1,60 @@
+#ifndef __PrimeEngineServerWorkerPool_H__
+#define __PrimeEngineServerWorkerPool_H__
+
+// API Abstraction
+#include "PrimeEngine/APIAbstraction/APIAbstractionDefines.h"
+
+// Outer-Engine includes
+#include <assert.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Inter-Engine includes
+
+// Sibling/Children includes
+
+namespace PE {
+
+// Fixed set of worker threads that run one function over N shards in parallel.
+// Calling thread works on shard 0 and returns when all shards are done, so work submitted in one run()
+// never overlaps with anything the calling thread does before or after. Used by ServerNetworkManager
+// to receive and assemble packets of many connections at once.
+struct ServerWorkerPool
+{
+	typedef std::function<void(int shard, int numShards)> ShardFunction;
+
+	ServerWorkerPool();
+	~ServerWorkerPool();
+
+	/// stops current workers and starts numWorkers new ones. 0 = everything runs on calling thread
+	void start(int numWorkers);
+	void stop();
+
+	/// number of shards work is split into: workers + calling thread
+	int getNumShards(){return (int)(m_threads.size()) + 1;}
+
+	/// runs function for shards 0..getNumShards()-1, blocks until all of them return
+	void run(const ShardFunction &function);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Member variables
+	//////////////////////////////////////////////////////////////////////////
+
+	void workerLoop(int shard, unsigned int lastRun);
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workDone;
+	const ShardFunction *m_pFunction;
+	unsigned int m_runIndex; // bumped every run so that workers know there is new work
+	int m_numShards;
+	int m_numPending;
+	bool m_quit;
+};
+
+}; // namespace PE
+#endif
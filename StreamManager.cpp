@@ -5,10 +5,13 @@
 #include "StreamManager.h"
 
 // Outer-Engine includes
+#include <string.h>
 
 // Inter-Engine includes
 
+#if !PE_NETWORKING_HEADLESS
 #include "../Lua/LuaEnvironment.h"
+#endif
 
 // additional lua includes needed
 extern "C"
@@ -22,7 +25,11 @@ extern "C"
 
 // Sibling/Children includes
 #include "EventManager.h"
+#include "GhostManager.h"
+#include "MoveManager.h"
+#include "DatablockManager.h"
 #include "ConnectionManager.h"
+#include "NetworkManager.h"
 
 #if APIABSTRACTION_PS3
 #define NET_LITTLE_ENDIAN 1
@@ -37,12 +44,28 @@ namespace Components {
 
 PE_IMPLEMENT_CLASS1(StreamManager, Component);
 
+thread_local NetStringTable *StreamManager::s_pActiveStringTable = NULL;
+
 StreamManager::StreamManager(PE::GameContext &context, PE::MemoryArena arena, PE::NetworkContext &netContext, Handle hMyself)
 : Component(context, arena, hMyself)
-, m_transmissionRecords(1024)
 {
-	m_nextIdToTransmit = 0;
+	m_pState = &m_ownState;
+	m_stateSlot = 0;
+	m_ownState.resetSlot(0, m_pContext->getNetworkManager()->getNetworkTime());
+	m_lastTickNumber = m_pContext->getNetworkManager()->getTickNumber();
+	m_packetRate = PE_PACKET_DEFAULT_RATE;
+	m_congestion.setRateLimits(PE_PACKET_MIN_RATE, (float)(m_packetRate));
+	m_maxPacketSize = PE_PACKET_TOTAL_SIZE;
+	m_sendBuffer.resize(PE_PACKET_TOTAL_SIZE);
+	m_datagramSize = PE_PACKET_DEFAULT_DATAGRAM_SIZE;
+	m_mtuProbing = false;
+	m_probeHigh = PE_PACKET_TOTAL_SIZE;
+	m_probeSize = 0;
+	m_probePacketId = 0;
+	m_probeFailures = 0;
+	m_lastProbeTime = 0;
 	m_pNetContext = &netContext;
+	publishSendBudget();
 }
 
 StreamManager::~StreamManager()
@@ -56,33 +79,137 @@ void StreamManager::initialize()
 }
 
 
+void StreamManager::bindState(ConnectionStateTable *pTable, int slot)
+{
+	pTable->copySlot(slot, *m_pState, m_stateSlot);
+	m_pState = pTable;
+	m_stateSlot = slot;
+}
+
+void StreamManager::publishSendBudget()
+{
+	m_pState->m_sendRate[m_stateSlot] = m_congestion.getSendRate();
+	m_pState->m_numPacketsInFlight[m_stateSlot] = (int)(m_transmissionRecords.size());
+}
+
+void StreamManager::setPacketRate(int packetsPerSecond)
+{
+	if (packetsPerSecond < PE_PACKET_MIN_RATE)
+		packetsPerSecond = PE_PACKET_MIN_RATE;
+	if (packetsPerSecond > PE_PACKET_MAX_RATE)
+		packetsPerSecond = PE_PACKET_MAX_RATE;
+	m_packetRate = packetsPerSecond;
+	m_congestion.setRateLimits(PE_PACKET_MIN_RATE, (float)(m_packetRate));
+	publishSendBudget();
+}
+
+void StreamManager::setMaxPacketSize(int bytes)
+{
+	if (bytes < PE_PACKET_MIN_SIZE)
+		bytes = PE_PACKET_MIN_SIZE;
+	if (bytes > PE_PACKET_TOTAL_SIZE)
+		bytes = PE_PACKET_TOTAL_SIZE;
+	m_maxPacketSize = bytes;
+	publishSendBudget();
+}
+
+void StreamManager::setDatagramSize(int bytes)
+{
+	if (bytes < PE_PACKET_MIN_SIZE)
+		bytes = PE_PACKET_MIN_SIZE;
+	if (bytes > PE_PACKET_TOTAL_SIZE)
+		bytes = PE_PACKET_TOTAL_SIZE;
+	m_datagramSize = bytes;
+	m_probeHigh = PE_PACKET_TOTAL_SIZE;
+	m_probeFailures = 0;
+	publishSendBudget();
+}
+
+int StreamManager::nextProbeSize(double now)
+{
+	if (!m_mtuProbing || m_probePacketId || now - m_lastProbeTime < PE_MTU_PROBE_INTERVAL)
+		return 0;
+
+	int high = m_probeHigh < m_maxPacketSize ? m_probeHigh : m_maxPacketSize;
+	if (high - m_datagramSize < PE_MTU_PROBE_GRANULARITY)
+		return 0; // search is done
+
+	return (m_datagramSize + high + 1) / 2;
+}
+
+void StreamManager::processProbeResult(bool delivered)
+{
+	m_probePacketId = 0;
+
+	if (delivered)
+	{
+		if (m_probeSize > m_datagramSize)
+			m_datagramSize = m_probeSize;
+		m_probeFailures = 0;
+		return;
+	}
+
+	// one lost probe may be regular packet loss
+	if (++m_probeFailures >= PE_MTU_PROBE_ATTEMPTS)
+	{
+		m_probeHigh = m_probeSize - 1;
+		m_probeFailures = 0;
+	}
+}
+
 void StreamManager::sendNextPackets()
 {
+    // ghosts that don't make it into packets this tick will have higher priority next tick
+    m_pNetContext->getGhostManager()->accumulatePriorities();
+
+    ConnectionStateTable &state = *m_pState;
+    int slot = m_stateSlot;
+
+    // no-op if server already refilled all connections this tick
+    state.refillTokens(slot, m_pContext->getNetworkManager()->getNetworkTime());
+
     while (true)
     {
+        if (!state.canSend(slot))
+            return; // over budget, whatever is queued waits for next send slot
+
+        // every now and then one packet is padded to a bigger size to find out whether path takes it
+        double now = m_pContext->getNetworkManager()->getNetworkTime();
+        int probeSize = nextProbeSize(now);
+        int packetSizeLimit = probeSize ? probeSize : getDatagramSize();
+
         int size = PE_PACKET_HEADER; // space for size
-        int sizeLeft = PE_PACKET_TOTAL_SIZE - size;
+        int sizeLeft = packetSizeLimit - size;
 
         // allocate data for next packet
 	
         int numEvents = m_pNetContext->getEventManager()->haveEventsToSend();
 
-        //todo: other managers
-        int numGhosts = 0;
+        int numGhosts = m_pNetContext->getGhostManager()->haveGhostsToSend();
 
-        if (numEvents || numGhosts) //todo: other managers
+        int numMoves = m_pNetContext->getMoveManager()->haveMovesToSend();
+
+        int numDatablockMessages = m_pNetContext->getDatablockManager()->haveDatablocksToSend();
+
+        // idle connection still sends a packet now and then, asking other side to acknowledge it
+        bool keepAlive = now - state.m_lastSendTime[slot] >= PE_CONNECTION_KEEPALIVE_INTERVAL;
+
+        if (numEvents || numGhosts || numMoves || numDatablockMessages || state.m_ackPending[slot] || keepAlive) //todo: other managers
         {
             m_transmissionRecords.push_back(TransmissionRecord());
             TransmissionRecord &record = m_transmissionRecords.back();
+            record.m_id = state.m_nextIdToTransmit[slot] + 1; // managers can use packet id while filling in (ghost baselines)
+            record.m_sendTime = m_pContext->getNetworkManager()->getNetworkTime();
         
 
-            PE::Packet *pPacket = (PE::Packet *)(pemalloc(m_arena, PE_PACKET_TOTAL_SIZE));
+            // per connection buffer, not the arena: packets of different connections can be assembled on different threads
+            PE::Packet *pPacket = (PE::Packet *)(&m_sendBuffer[0]);
 
             bool usefulEventDataSent = false;
             bool wantToSendMoreEvents = false;
             //event manager
             {
-                sizeLeft = PE_PACKET_TOTAL_SIZE - size;
+                sizeLeft = packetSizeLimit - PE_PACKET_STREAM_HEADERS - size;
                 size += m_pNetContext->getEventManager()->fillInNextPacket(&pPacket->m_data[size], &record, sizeLeft, usefulEventDataSent, wantToSendMoreEvents);
             }
 
@@ -93,16 +220,61 @@ void StreamManager::sendNextPackets()
             
             // ghost manager
             {
-                sizeLeft = PE_PACKET_TOTAL_SIZE - size;
-                size += 0;//m_pNetContext->getEventManager()->fillInNextPacket(&pPacket->m_data[size], &record, sizeLeft, usefulGhostDataSent, wantToSendMoreGhosts);
+                sizeLeft = packetSizeLimit - PE_PACKET_STREAM_HEADERS - size;
+                size += m_pNetContext->getGhostManager()->fillInNextPacket(&pPacket->m_data[size], &record, sizeLeft, usefulGhostDataSent, wantToSendMoreGhosts);
+            }
+
+            bool usefulMoveDataSent = false;
+            bool wantToSendMoreMoves = false;
+
+            // move manager
+            {
+                sizeLeft = packetSizeLimit - size;
+                size += m_pNetContext->getMoveManager()->fillInNextPacket(&pPacket->m_data[size], &record, sizeLeft, usefulMoveDataSent, wantToSendMoreMoves);
+            }
+
+            bool usefulDatablockDataSent = false;
+            bool wantToSendMoreDatablocks = false;
+
+            // datablock manager gets what is left
+            {
+                sizeLeft = packetSizeLimit - size;
+                size += m_pNetContext->getDatablockManager()->fillInNextPacket(&pPacket->m_data[size], &record, sizeLeft, usefulDatablockDataSent, wantToSendMoreDatablocks);
             }
 
             assert(size > PE_PACKET_HEADER);// we should have filled in something!
             if (size > PE_PACKET_HEADER)
             {
-                StreamManager::WriteInt32(size, &pPacket->m_data[0] /*= &pPacket->m_packetDataSizeInInet*/); // header was allocated in the beginning
-                record.m_id = ++m_nextIdToTransmit;
-                m_pNetContext->getConnectionManager()->sendPacket(pPacket, &record); // note, we currently have automatic fake acknowldgements so transmission record will be popped in this method
+                if (probeSize)
+                {
+                    // receiver stops reading after datablock stream, padding is ignored
+                    memset(&pPacket->m_data[size], 0, probeSize - size);
+                    size = probeSize;
+
+                    m_probeSize = probeSize;
+                    m_probePacketId = record.m_id;
+                    m_lastProbeTime = now;
+                }
+
+                // header was allocated in the beginning
+                int headerSize = 0;
+                headerSize += StreamManager::WriteInt32(size, &pPacket->m_data[headerSize] /*= &pPacket->m_packetDataSizeInInet*/);
+                headerSize += StreamManager::WriteInt32(record.m_id, &pPacket->m_data[headerSize]);
+                headerSize += StreamManager::WriteInt32(state.m_lastReceivedPacketId[slot], &pPacket->m_data[headerSize]);
+                headerSize += StreamManager::WriteInt32((PrimitiveTypes::Int32)(state.m_receivedAckBits[slot]), &pPacket->m_data[headerSize]);
+                // moves are sent redundantly and don't need packet acknowledgment
+                headerSize += StreamManager::WriteInt32((usefulEventDataSent || usefulGhostDataSent || usefulDatablockDataSent || keepAlive) ? PE_PACKET_FLAG_NEEDS_ACK : 0, &pPacket->m_data[headerSize]);
+                assert(headerSize == PE_PACKET_HEADER);
+
+                ++state.m_nextIdToTransmit[slot];
+                state.m_ackPending[slot] = 0; // this packet carries our acknowledgments
+
+                state.m_packetTokens[slot] -= 1.0f;
+                state.m_lastSendTime[slot] = now;
+                state.m_numPacketsInFlight[slot] = (int)(m_transmissionRecords.size());
+
+                // transmission record stays until the other side acknowledges the packet (or we know it was lost), see processAcks()
+                m_pNetContext->getConnectionManager()->sendPacket(pPacket, &record);
             }
             else
             {
@@ -111,9 +283,8 @@ void StreamManager::sendNextPackets()
                 m_transmissionRecords.pop_back(); // cleanup failed transmission record
             }
 		
-            pefree(m_arena, pPacket);
             
-            if (!wantToSendMoreEvents && !wantToSendMoreGhosts)
+            if (!wantToSendMoreEvents && !wantToSendMoreGhosts && !wantToSendMoreMoves && !wantToSendMoreDatablocks)
                 return;
         }
         else
@@ -129,16 +300,70 @@ void StreamManager::processNotification(bool delivered)
 
 
 	m_pNetContext->getEventManager()->processNotification(&record, delivered);
-	
-    // todo: other managers here..
+
+	m_pNetContext->getGhostManager()->processNotification(&record, delivered);
+
+	m_pNetContext->getDatablockManager()->processNotification(&record, delivered);
 
 	m_transmissionRecords.pop_front();
 }
 
+void StreamManager::processAcks(PrimitiveTypes::Int32 ackId, PrimitiveTypes::UInt32 ackBits)
+{
+	double now = m_pContext->getNetworkManager()->getNetworkTime();
+
+	// important: notify events have to happen in same order as the packets were sent
+	while (m_transmissionRecords.size())
+	{
+		TransmissionRecord &record = m_transmissionRecords.front();
+		if (record.m_id > ackId)
+			break; // other side doesn't know about this packet yet
+
+		int age = ackId - record.m_id;
+		bool delivered = age == 0 || (age <= PE_PACKET_ACK_BITS && (ackBits & (1u << (age - 1))));
+
+		if (age == 0)
+		{
+			// newest packet the other side got, time until its ack arrived is round trip time
+			// (includes the time other side waited to send a packet back)
+			m_congestion.addRttSample((float)(now - record.m_sendTime));
+		}
+
+		if (record.m_id == m_probePacketId)
+		{
+			// lost probe says nothing about congestion
+			if (delivered)
+				m_congestion.onPacketNotification(delivered, record.m_sendTime, now);
+			processProbeResult(delivered);
+		}
+		else
+			m_congestion.onPacketNotification(delivered, record.m_sendTime, now);
+
+		processNotification(delivered);
+	}
+
+	if (ackId + 1 > m_pState->m_nextIdToBeAcknowledged[m_stateSlot])
+		m_pState->m_nextIdToBeAcknowledged[m_stateSlot] = ackId + 1;
+
+	// send rate and datagram size may have changed
+	publishSendBudget();
+}
+
 
 void StreamManager::do_UPDATE(Events::Event *pEvt)
 {
-	sendNextPackets();
+	// runs once per network tick, also catch-up ticks of a long frame. token bucket spreads their packets anyway
+	// (ticks are advanced here too, network manager may update after its children)
+	NetworkManager *pNetworkManager = m_pContext->getNetworkManager();
+	pNetworkManager->runTicks();
+
+	PrimitiveTypes::UInt32 ticks = pNetworkManager->getTickNumber() - m_lastTickNumber;
+	if (ticks > (PrimitiveTypes::UInt32)(PE_NETWORK_MAX_TICKS_PER_FRAME))
+		ticks = PE_NETWORK_MAX_TICKS_PER_FRAME;
+	m_lastTickNumber = pNetworkManager->getTickNumber();
+
+	for (PrimitiveTypes::UInt32 i = 0; i < ticks; ++i)
+		sendNextPackets();
 }
 
 void StreamManager::addDefaultComponents()
@@ -195,17 +420,74 @@ int ConnectionManager::l_clientConnectToTCPServer(lua_State *luaVM)
 
 // Sending functionality
 
+double StreamManager::getTimeSinceLastReceive()
+{
+	return m_pContext->getNetworkManager()->getNetworkTime() - m_pState->m_lastReceiveTime[m_stateSlot];
+}
+
 void StreamManager::receivePacket(Packet *pPacket)
 {
+	ConnectionStateTable &state = *m_pState;
+	int slot = m_stateSlot;
+
+	// any packet, even duplicate, means other side is alive
+	state.m_lastReceiveTime[slot] = m_pContext->getNetworkManager()->getNetworkTime();
+
 	int read = 0;
 
 	PrimitiveTypes::Int32 packetSize;
 	read += StreamManager::ReadInt32(&pPacket->m_data[read], packetSize);
 
+	PrimitiveTypes::Int32 packetId, ackId, ackBits, flags;
+	read += StreamManager::ReadInt32(&pPacket->m_data[read], packetId);
+	read += StreamManager::ReadInt32(&pPacket->m_data[read], ackId);
+	read += StreamManager::ReadInt32(&pPacket->m_data[read], ackBits);
+	read += StreamManager::ReadInt32(&pPacket->m_data[read], flags);
+
+	if (packetId <= state.m_lastReceivedPacketId[slot])
+	{
+		// duplicate or out of order packet. the other side will consider it lost since we don't set its ack bit
+		return;
+	}
+
+	// remember we got this packet, so that we can acknowledge it
+	int shift = packetId - state.m_lastReceivedPacketId[slot];
+	PrimitiveTypes::UInt32 &receivedAckBits = state.m_receivedAckBits[slot];
+	if (state.m_lastReceivedPacketId[slot] == 0)
+		receivedAckBits = 0;
+	else if (shift < PE_PACKET_ACK_BITS)
+		receivedAckBits = (receivedAckBits << shift) | (1u << (shift - 1));
+	else if (shift == PE_PACKET_ACK_BITS)
+		receivedAckBits = 1u << (PE_PACKET_ACK_BITS - 1);
+	else
+		receivedAckBits = 0;
+	state.m_lastReceivedPacketId[slot] = packetId;
+
+	if (flags & PE_PACKET_FLAG_NEEDS_ACK)
+		state.m_ackPending[slot] = 1;
+
+	processAcks(ackId, (PrimitiveTypes::UInt32)(ackBits));
+
 	// events are packed first
 	read += m_pNetContext->getEventManager()->receiveNextPacket(&pPacket->m_data[read]);
 
-	assert(packetSize == read);
+	// then ghost updates
+	int ghostsRead = m_pNetContext->getGhostManager()->receiveNextPacket(&pPacket->m_data[read], packetSize - read);
+	if (ghostsRead < 0)
+		return; // malformed, the rest can't be trusted
+	read += ghostsRead;
+
+	// then moves
+	int movesRead = m_pNetContext->getMoveManager()->receiveNextPacket(&pPacket->m_data[read], packetSize - read);
+	if (movesRead < 0)
+		return; // malformed, the rest can't be trusted
+	read += movesRead;
+
+	// then datablock stream
+	read += m_pNetContext->getDatablockManager()->receiveNextPacket(&pPacket->m_data[read]);
+
+	// mtu probes are padded with zeros after the datablock stream, the padding is not read
+	assert(read <= packetSize);
 }
 
 
@@ -247,6 +529,29 @@ int StreamManager::ReadInt32(char *pDataStream, PrimitiveTypes::Int32 &out_v)
 	return sizeof(PrimitiveTypes::Int32);
 }
 
+int StreamManager::WriteInt16(PrimitiveTypes::Int16 v, char *pDataStream)
+{
+	PrimitiveTypes::Int32 v32 = v;
+	char tmp[4];
+	WriteInt32(v32, tmp);
+
+	// Int32 goes out most significant byte first, low two bytes are at the end
+	memcpy(pDataStream, &tmp[2], sizeof(PrimitiveTypes::Int16));
+	return sizeof(PrimitiveTypes::Int16);
+}
+
+int StreamManager::ReadInt16(char *pDataStream, PrimitiveTypes::Int16 &out_v)
+{
+	char tmp[4] = {0, 0, 0, 0};
+	memcpy(&tmp[2], pDataStream, sizeof(PrimitiveTypes::Int16));
+
+	PrimitiveTypes::Int32 v32;
+	ReadInt32(tmp, v32);
+	out_v = (PrimitiveTypes::Int16)(v32);
+
+	return sizeof(PrimitiveTypes::Int16);
+}
+
 int StreamManager::WriteFloat32(PrimitiveTypes::Float32 v, char *pDataStream)
 {
 	#if !NET_LITTLE_ENDIAN 
@@ -321,6 +626,76 @@ int StreamManager::ReadNetworkId(char *pDataStream, Networkable::NetworkId &out_
 	return res;
 }
 
+int StreamManager::WriteNetString(const char *str, char *pDataStream)
+{
+	NetStringTable *pTable = s_pActiveStringTable;
+	PrimitiveTypes::Int16 id = pTable ? pTable->intern(str) : 0;
+
+	int size = 0;
+	if (id && pTable->isAcknowledged(id))
+	{
+		// the other side knows this string
+		size += WriteInt16(id, &pDataStream[size]);
+		return size;
+	}
+
+	// negative id = definition, 0 = not interned. string follows, with terminating zero so that receiver can point at it
+	size += WriteInt16(-id, &pDataStream[size]);
+	if (id)
+		pTable->noteDefinitionSent(id);
+
+	int len = (int)(strlen(str));
+	size += WriteInt16((PrimitiveTypes::Int16)(len), &pDataStream[size]);
+	memcpy(&pDataStream[size], str, len + 1);
+	size += len + 1;
+
+	return size;
+}
+
+int StreamManager::ReadNetString(char *pDataStream, int dataSizeLeft, const char *&out_str)
+{
+	NetStringTable *pTable = s_pActiveStringTable;
+	out_str = "";
+
+	int read = 0;
+	if (dataSizeLeft < (int)(sizeof(PrimitiveTypes::Int16)))
+		return -1;
+
+	PrimitiveTypes::Int16 id;
+	read += ReadInt16(&pDataStream[read], id);
+
+	if (id > 0)
+	{
+		out_str = pTable ? pTable->resolve(id) : NULL;
+		if (!out_str)
+		{
+			PEINFO("PE: Warning: Received net string id %d that was never defined\n", (int)(id));
+			out_str = "";
+		}
+		return read;
+	}
+
+	if (dataSizeLeft - read < (int)(sizeof(PrimitiveTypes::Int16)))
+		return -1;
+
+	PrimitiveTypes::Int16 len;
+	read += ReadInt16(&pDataStream[read], len);
+
+	// length comes from the other side, string has to end inside the packet
+	if (len < 0 || len + 1 > dataSizeLeft - read || pDataStream[read + len] != 0)
+	{
+		PEINFO("PE: Warning: Received net string with invalid length %d\n", (int)(len));
+		return -1;
+	}
+
+	out_str = &pDataStream[read];
+	read += len + 1;
+
+	if (id < 0 && pTable && !pTable->define(-(int)(id), out_str))
+		PEINFO("PE: Warning: Received net string definition with invalid id %d\n", -(int)(id));
+
+	return read;
+}
 	
 }; // namespace Components
 }; // namespace PE
@@ -7,6 +7,7 @@
 // Outer-Engine includes
 #include <assert.h>
 #include <deque>
+#include <vector>
 
 // Inter-Engine includes
 
@@ -24,6 +25,9 @@ extern "C"
 
 // Sibling/Children includes
 #include "Packet.h"
+#include "CongestionController.h"
+#include "ConnectionStateTable.h"
+#include "NetworkingConfig.h"
 
 namespace PE {
 namespace Components {
@@ -46,9 +50,46 @@ struct StreamManager : public Component
 
 	void processNotification(bool delivered);
 
+	/// processes acknowledgment info of received packet header. notifies managers of delivery of our packets in order they were sent
+	void processAcks(PrimitiveTypes::Int32 ackId, PrimitiveTypes::UInt32 ackBits);
+
+	/// smoothed round trip time in seconds. 0 until first packet is acknowledged
+	float getRtt(){return m_congestion.getSrtt();}
+
+	/// rtt variance, loss estimate and current send rate of this connection
+	CongestionController &getCongestionController(){return m_congestion;}
+
+	/// seconds since last packet arrived from other side. keepalives make sure live connections never get close to timeout
+	double getTimeSinceLastReceive();
+
+	/// send budget of this connection: packets per second and max bytes per packet (clamped to PE_PACKET_* limits)
+	/// packet rate is the ceiling, congestion controller sends slower when packets get lost
+	void setPacketRate(int packetsPerSecond);
+	void setMaxPacketSize(int bytes);
+	int getPacketRate(){return m_packetRate;}
+	int getMaxPacketSize(){return m_maxPacketSize;}
+
+	/// size datagrams are filled up to: PE_PACKET_DEFAULT_DATAGRAM_SIZE, raised by path MTU probing, never above max packet size
+	int getDatagramSize(){return m_datagramSize < m_maxPacketSize ? m_datagramSize : m_maxPacketSize;}
+	/// use when path MTU is known (e.g. LAN), probing continues from here if enabled
+	void setDatagramSize(int bytes);
+	void enableMtuProbing(bool enable){m_mtuProbing = enable;}
+
+	/// moves per tick state of this connection to slot of shared table (server: one table for all clients, slot = client id)
+	/// table must not be resized while bound
+	void bindState(ConnectionStateTable *pTable, int slot);
+	ConnectionStateTable &getState(){return *m_pState;}
+	int getStateSlot(){return m_stateSlot;}
+
+	/// id of latest packet received, while packet is being processed this is its id
+	PrimitiveTypes::Int32 getLastReceivedPacketId(){return m_pState->m_lastReceivedPacketId[m_stateSlot];}
+
 	static int WriteInt32(PrimitiveTypes::Int32 v, char *pDataStream);
 	static int ReadInt32(char *pDataStream, PrimitiveTypes::Int32 &out_v);
 
+	static int WriteInt16(PrimitiveTypes::Int16 v, char *pDataStream);
+	static int ReadInt16(char *pDataStream, PrimitiveTypes::Int16 &out_v);
+
 	static int WriteFloat32(PrimitiveTypes::Float32 v, char *pDataStream);
 	static int ReadFloat32(char *pDataStream, PrimitiveTypes::Float32 &out_v);
 
@@ -61,6 +102,25 @@ struct StreamManager : public Component
 	static int WriteNetworkId(Networkable::NetworkId v, char *pDataStream);
 	static int ReadNetworkId(char *pDataStream, Networkable::NetworkId &out_v);
 
+	// strings go through string table of the connection being packed/unpacked (s_pActiveStringTable):
+	// a string is sent in full until the other side acknowledges it, then only its id is sent
+	// without active table the string is always sent in full
+	static int WriteNetString(const char *str, char *pDataStream);
+	// out_str is valid until the packet is processed, copy it if needed
+	// dataSizeLeft is what is left of the packet. returns -1 if string doesn't fit in it or is not terminated (out_str is then "")
+	static int ReadNetString(char *pDataStream, int dataSizeLeft, const char *&out_str);
+
+	static thread_local NetStringTable *s_pActiveStringTable; // per thread, connections can be serviced in parallel
+
+	// sets active string table for its lifetime and restores the previous one, so nested packing keeps the outer table
+	struct ActiveStringTableScope
+	{
+		ActiveStringTableScope(NetStringTable *pTable) : m_pPrevTable(s_pActiveStringTable) { s_pActiveStringTable = pTable; }
+		~ActiveStringTableScope() { s_pActiveStringTable = m_pPrevTable; }
+
+		NetStringTable *m_pPrevTable;
+	};
+
 	
 	// Component ------------------------------------------------------------
 	virtual void addDefaultComponents();
@@ -89,12 +149,32 @@ struct StreamManager : public Component
 	//////////////////////////////////////////////////////////////////////////
 	std::deque<TransmissionRecord> m_transmissionRecords;
 
-	//receiving context
-	int m_firstIdNotYetReceived;
-	
-	// sending context
-	int m_nextIdToTransmit;
-	int m_nextIdToBeAcknowledged;
+	// sequence numbers, ack state, token bucket and send/receive times. own one-slot table until bindState()
+	// token bucket is refilled at congestion controller's send rate. a packet can go out if there is a packet token
+	ConnectionStateTable m_ownState;
+	ConnectionStateTable *m_pState;
+	int m_stateSlot;
+
+	CongestionController m_congestion;
+
+	PrimitiveTypes::UInt32 m_lastTickNumber; // network tick packets were last sent on (do_UPDATE)
+
+	std::vector<char> m_sendBuffer; // packet being assembled
+
+	int m_packetRate;
+	int m_maxPacketSize;
+	void publishSendBudget(); // copies send rate and number of packets in flight to state table
+
+	// path MTU discovery. m_datagramSize is confirmed size, probe searches (m_datagramSize, m_probeHigh]
+	int m_datagramSize;
+	bool m_mtuProbing;
+	int m_probeHigh;
+	int m_probeSize;
+	PrimitiveTypes::UInt32 m_probePacketId; // 0 = no probe in flight
+	int m_probeFailures;
+	double m_lastProbeTime;
+	int nextProbeSize(double now);
+	void processProbeResult(bool delivered);
 
 	PE::NetworkContext *m_pNetContext;
 };